@@ -12,11 +12,55 @@
 #include <stdexcept>
 #include <utility>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <limits>
 #include <random>
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <memory>
+#include <new>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <fstream>
+#include <chrono>
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define HASHING_HAVE_PMR 1
+#endif
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASHING_HAVE_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Build with -DHASHING_STATS=1 to collect per-operation probe counts and
+// rehash timings for stats(); off by default and free when off.
+#ifndef HASHING_STATS
+#define HASHING_STATS 0
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define HASHING_HAVE_MMAP 1
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 
 
 // -----------------------------
@@ -28,6 +72,8 @@
 //   // (optional) second hash used by double hashing; must be non-zero and < mod
 //   size_t second(const key_type& k, size_t mod) const; // optional
 // };
+// Heterogeneous lookups (transparent KeyEqual) call the policy with the lookup
+// type as well, so it has to accept it (see PolynomialRollingHash).
 // -----------------------------
 
 // -----------------------------
@@ -41,14 +87,20 @@ struct DivisionHash {
     // For integral types only
     static_assert(std::is_integral<Key>::value, "DivisionHash requires integral Key");
     size_t operator()(Key k, size_t mod) const noexcept {
-        return static_cast<size_t>( ( (k % static_cast<Key>(mod)) + static_cast<Key>(mod) ) % static_cast<Key>(mod) );
+        // reduced in 64 bits: mod (a capacity or kHashRange) may not fit a narrow Key
+        if constexpr (std::is_signed<Key>::value) {
+            const int64_t m = static_cast<int64_t>(std::min<uint64_t>(mod, INT64_MAX));
+            int64_t r = static_cast<int64_t>(k) % m;
+            return static_cast<size_t>(r < 0 ? r + m : r);
+        } else {
+            return static_cast<size_t>(static_cast<uint64_t>(k) % mod);
+        }
     }
     // second hash for double hashing (if needed): make odd
     size_t second(Key k, size_t mod) const noexcept {
         // return 1 + (k mod (mod-1))
         size_t m1 = (mod > 1 ? mod - 1 : 1);
-        size_t r = static_cast<size_t>( ( (k % static_cast<Key>(m1)) + static_cast<Key>(m1) ) % static_cast<Key>(m1) );
-        return 1 + r;
+        return 1 + (*this)(k, m1);
     }
 };
 
@@ -94,14 +146,15 @@ struct MidSquareHash {
     }
 };
 
-// Polynomial rolling hash for strings using Horner's rule
+// Polynomial rolling hash for strings using Horner's rule. Takes string_view so
+// std::string keys can be looked up by string_view / const char* without a copy.
 struct PolynomialRollingHash {
     using key_type = std::string;
     const uint64_t base;
     const uint64_t modprime; // prime modulus for internal mixing (we still reduce mod table size)
     PolynomialRollingHash(uint64_t base_ = 257, uint64_t modprime_ = 1000000007ULL)
         : base(base_), modprime(modprime_) {}
-    size_t operator()(const std::string& s, size_t mod) const noexcept {
+    size_t operator()(std::string_view s, size_t mod) const noexcept {
         uint64_t r = 0;
         for (unsigned char c : s) {
             r = (r * base + static_cast<uint64_t>(c)) % modprime;
@@ -109,7 +162,7 @@ struct PolynomialRollingHash {
         return static_cast<size_t>(r % mod);
     }
     // second hash: simple polynomial with different base
-    size_t second(const std::string& s, size_t mod) const noexcept {
+    size_t second(std::string_view s, size_t mod) const noexcept {
         uint64_t r = 0, otherBase = base ^ 1315423911u;
         for (unsigned char c : s) {
             r = (r * otherBase + static_cast<uint64_t>(c)) % modprime;
@@ -119,6 +172,14 @@ struct PolynomialRollingHash {
     }
 };
 
+// std::hash replacement for std::string keys in the std::hash-based maps
+// (SwissHashMap, ChainingHashMap) that also hashes string_view / const char*
+// lookups to the same value without building a std::string.
+struct StringViewHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>()(s); }
+};
+
 // Universal hashing family: h_{a,b}(k) = ((a*k + b) mod p) mod m
 // Works for integral keys. User provides prime p > max(key).
 template <typename Key>
@@ -141,6 +202,170 @@ struct UniversalHash {
     }
 };
 
+// -----------------------------
+// Fast 64-bit policies. Both compute one full 64-bit hash per key and reduce
+// it onto [0, mod) with a multiply (high half of h * mod) instead of a
+// division; second() reuses the other half of the same hash. The one-argument
+// operator() returns the raw 64-bit hash, so they also drop in wherever
+// std::hash is expected (SwissHashMap, ChainingHashMap).
+// -----------------------------
+
+// Utility: 64-bit finalizer (murmur3 fmix64). Spreads a weak hash (e.g. the
+// identity std::hash<int>) over all 64 bits so high and low bits are usable.
+constexpr uint64_t mix64(uint64_t x) noexcept {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// 64x64 -> 128-bit multiply
+inline void mul128(uint64_t a, uint64_t b, uint64_t& lo, uint64_t& hi) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    lo = static_cast<uint64_t>(r);
+    hi = static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t a_lo = a & 0xffffffffULL, a_hi = a >> 32, b_lo = b & 0xffffffffULL, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> 32) + (lh & 0xffffffffULL) + (hl & 0xffffffffULL);
+    lo = (mid << 32) | (ll & 0xffffffffULL);
+    hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+// folded multiply: xor of both product halves (the wyhash mixing step)
+inline uint64_t fold_mul(uint64_t a, uint64_t b) noexcept {
+    uint64_t lo, hi;
+    mul128(a, b, lo, hi);
+    return lo ^ hi;
+}
+
+// Maps h onto [0, mod) using its high bits: floor(h * mod / 2^64)
+inline size_t reduce_range(uint64_t h, size_t mod) noexcept {
+    uint64_t lo, hi;
+    mul128(h, mod, lo, hi);
+    return static_cast<size_t>(hi);
+}
+
+// wyhash-style string hash: reads 8 (or 4) bytes at a time and mixes with
+// 128-bit multiplies, three independent lanes for long inputs.
+struct WyHash {
+    using key_type = std::string;
+    using is_transparent = void;
+    uint64_t seed;
+    explicit WyHash(uint64_t seed_ = 0) : seed(seed_) {}
+
+    size_t operator()(std::string_view s, size_t mod) const noexcept { return reduce_range(hash64(s), mod); }
+    size_t second(std::string_view s, size_t mod) const noexcept {
+        uint64_t h = hash64(s);
+        return 1 + reduce_range((h << 32) | (h >> 32), mod > 1 ? mod - 1 : 1);
+    }
+    size_t operator()(std::string_view s) const noexcept { return static_cast<size_t>(hash64(s)); }
+
+    uint64_t hash64(std::string_view s) const noexcept {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+        size_t len = s.size();
+        uint64_t h = seed ^ fold_mul(seed ^ kP0, kP1);
+        uint64_t a, b;
+        if (len <= 16) {
+            if (len >= 4) {
+                size_t off = (len >> 3) << 2; // 0 or 4: the two 4-byte reads overlap for len < 8
+                a = (read4(p) << 32) | read4(p + off);
+                b = (read4(p + len - 4) << 32) | read4(p + len - 4 - off);
+            } else if (len > 0) {
+                a = (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t i = len;
+            if (i > 48) {
+                uint64_t h1 = h, h2 = h;
+                do {
+                    h = fold_mul(read8(p) ^ kP1, read8(p + 8) ^ h);
+                    h1 = fold_mul(read8(p + 16) ^ kP2, read8(p + 24) ^ h1);
+                    h2 = fold_mul(read8(p + 32) ^ kP3, read8(p + 40) ^ h2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                h ^= h1 ^ h2;
+            }
+            while (i > 16) {
+                h = fold_mul(read8(p) ^ kP1, read8(p + 8) ^ h);
+                p += 16;
+                i -= 16;
+            }
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+        mul128(a ^ kP1, b ^ h, a, b);
+        return fold_mul(a ^ kP0 ^ len, b ^ kP1);
+    }
+
+private:
+    static constexpr uint64_t kP0 = 0xa0761d6478bd642fULL, kP1 = 0xe7037ed1a0b428dbULL,
+                              kP2 = 0x8ebc6af09c88c6e3ULL, kP3 = 0x589965cc75374cc3ULL;
+    static uint64_t read8(const unsigned char* p) noexcept { uint64_t v; std::memcpy(&v, p, 8); return v; }
+    static uint64_t read4(const unsigned char* p) noexcept { uint32_t v; std::memcpy(&v, p, 4); return v; }
+};
+
+// Integer hash: seeded moremur finalizer (a bijective xorshift-multiply mix,
+// every input bit affects every output bit).
+template <typename Key>
+struct IntegerMixHash {
+    using key_type = Key;
+    static_assert(std::is_integral<Key>::value, "IntegerMixHash requires integral Key");
+    uint64_t seed;
+    constexpr explicit IntegerMixHash(uint64_t seed_ = 0) : seed(seed_) {}
+
+    size_t operator()(Key k, size_t mod) const noexcept { return reduce_range(hash64(k), mod); }
+    size_t second(Key k, size_t mod) const noexcept {
+        uint64_t h = hash64(k);
+        return 1 + reduce_range((h << 32) | (h >> 32), mod > 1 ? mod - 1 : 1);
+    }
+    size_t operator()(Key k) const noexcept { return static_cast<size_t>(hash64(k)); }
+
+    constexpr uint64_t hash64(Key k) const noexcept {
+        uint64_t x = static_cast<uint64_t>(k) + seed;
+        x ^= x >> 27;
+        x *= 0x3c79ac492ba7b653ULL;
+        x ^= x >> 33;
+        x *= 0x1c69b3f74ac4ae35ULL;
+        x ^= x >> 27;
+        return x;
+    }
+};
+
+// Byte-at-a-time FNV-1a with a fmix64 finalizer. Much slower than WyHash on
+// long strings, but constexpr: the hash for compile-time tables
+// (StaticPerfectHashMap) over short string keys.
+struct Fnv1aHash {
+    using key_type = std::string_view;
+    using is_transparent = void;
+    uint64_t seed;
+    constexpr explicit Fnv1aHash(uint64_t seed_ = 0) : seed(seed_) {}
+
+    size_t operator()(std::string_view s, size_t mod) const noexcept { return reduce_range(hash64(s), mod); }
+    size_t second(std::string_view s, size_t mod) const noexcept {
+        uint64_t h = hash64(s);
+        return 1 + reduce_range((h << 32) | (h >> 32), mod > 1 ? mod - 1 : 1);
+    }
+    size_t operator()(std::string_view s) const noexcept { return static_cast<size_t>(hash64(s)); }
+
+    constexpr uint64_t hash64(std::string_view s) const noexcept {
+        uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+        for (char c : s) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 0x100000001b3ULL;
+        }
+        return mix64(h);
+    }
+};
+
 // -----------------------------
 // Utility: next prime for capacity sizing (simple)
 inline bool is_prime(size_t n) {
@@ -155,614 +380,5906 @@ inline size_t next_prime(size_t n) {
     return n;
 }
 
-// -----------------------------
-// Generic probing-map base helpers
-// -----------------------------
-
-enum class SlotState : uint8_t { Empty = 0, Occupied = 1, Deleted = 2 };
+// Utility: heterogeneous lookup support. A lookup template taking K only
+// participates when every listed functor declares is_transparent.
+template <typename T, typename = void>
+struct is_transparent : std::false_type {};
+template <typename T>
+struct is_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
 
-// A utility slot storing key/value and state
-template <typename Key, typename Value>
-struct Slot {
-    SlotState state;
-    Key key;
-    Value value;
-    Slot() : state(SlotState::Empty), key(), value() {}
-};
+template <typename K, typename... Fns>
+using transparent_key_t = std::enable_if_t<(is_transparent<Fns>::value && ...), K>;
 
-// -----------------------------
-// Linear probing map
-// -----------------------------
-template <
-    typename Key,
-    typename Value,
-    typename HashPolicy = DivisionHash<Key>,
-    typename KeyEqual = std::equal_to<Key>
->
-class LinearProbingHashMap {
-public:
-    using key_type = Key;
-    using mapped_type = Value;
-    using hash_policy = HashPolicy;
+// Utility: ask the cache to start loading p; a hint only, p may be any address
+inline void prefetch(const void* p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
 
-    explicit LinearProbingHashMap(size_t initial_capacity = 16, double max_load = 0.6)
-        : policy_(), eq_(), size_(0), deleted_count_(0), max_load_(max_load) {
-        capacity_ = next_prime(std::max<size_t>(initial_capacity, 3));
-        table_.assign(capacity_, Slot<Key,Value>());
-    }
+// Utility: index of the lowest set bit (m must be non-zero)
+inline unsigned lowest_bit(uint32_t m) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return static_cast<unsigned>(i);
+#else
+    return static_cast<unsigned>(__builtin_ctz(m));
+#endif
+}
 
-    bool insert(const Key& k, const Value& v) {
-        if ((size_ + deleted_count_ + 1) > static_cast<size_t>(capacity_ * max_load_))
-            rehash(next_prime(capacity_ * 2));
+inline unsigned lowest_bit(uint64_t m) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward64(&i, m);
+    return static_cast<unsigned>(i);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(m));
+#endif
+}
 
-        size_t h = policy_(k, capacity_);
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h + i) % capacity_;
-            auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) {
-                slot.key = k;
-                slot.value = v;
-                slot.state = SlotState::Occupied;
-                ++size_;
-                return true;
-            } else if (slot.state == SlotState::Deleted) {
-                // reuse tombstone
-                slot.key = k;
-                slot.value = v;
-                slot.state = SlotState::Occupied;
-                ++size_;
-                --deleted_count_;
-                return true;
-            } else if (slot.state == SlotState::Occupied && eq_(slot.key, k)) {
-                // update
-                slot.value = v;
-                return false;
-            }
-        }
-        // table full (shouldn't happen thanks to resize)
-        rehash(next_prime(capacity_ * 2 + 1));
-        return insert(k, v);
-    }
+// Utility: number of set bits in x
+inline unsigned popcount64(uint64_t x) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return static_cast<unsigned>(__popcnt64(x));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(x));
+#endif
+}
 
-    std::optional<Value> find(const Key& k) const {
-        size_t h = policy_(k, capacity_);
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h + i) % capacity_;
-            const auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) return std::nullopt;
-            if (slot.state == SlotState::Occupied && eq_(slot.key, k)) return slot.value;
-            // if deleted or occupied with different key, continue
+// Utility: (re)assign a slot's value from constructor arguments. Slots hold
+// default-constructed values, so a single assignable argument is assigned
+// directly and anything else builds a temporary that is moved in.
+template <typename V, typename... Args>
+inline void assign_from(V& dst, Args&&... args) {
+    if constexpr (sizeof...(Args) == 1) {
+        if constexpr ((std::is_assignable<V&, Args&&>::value && ...)) {
+            ((dst = std::forward<Args>(args)), ...);
+            return;
         }
-        return std::nullopt;
-    }
-
-    bool contains(const Key& k) const {
-        return static_cast<bool>(find(k));
     }
+    dst = V(std::forward<Args>(args)...);
+}
 
-    bool erase(const Key& k) {
-        size_t h = policy_(k, capacity_);
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h + i) % capacity_;
-            auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) return false;
-            if (slot.state == SlotState::Occupied && eq_(slot.key, k)) {
-                slot.state = SlotState::Deleted;
-                // placement of key/value is optional; we leave them
-                --size_;
-                ++deleted_count_;
-                return true;
-            }
-        }
-        return false;
-    }
+// Utility: smallest power of two >= n (n > 0)
+constexpr size_t next_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
 
-    size_t size() const noexcept { return size_; }
-    void clear() noexcept {
-        table_.assign(capacity_, Slot<Key,Value>());
-        size_ = 0;
-        deleted_count_ = 0;
-    }
+// Utility: runs f(0) .. f(tasks-1) on up to `threads` threads (0 = one per
+// hardware thread), the calling thread included; tasks are handed out in
+// order through a shared counter. f must not throw.
+template <typename F>
+inline void parallel_for(size_t tasks, size_t threads, F&& f) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, tasks);
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < tasks;) f(i);
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
 
-    // Batch load vector of pairs
-    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup = false) {
-        if (dedup) {
-            // naive dedup: sort by key and insert unique
-            std::vector<std::pair<Key,Value>> tmp = items;
-            std::sort(tmp.begin(), tmp.end(), [&](auto &a, auto &b){ return a.first < b.first; });
-            tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
-            for (auto &kv : tmp) insert(kv.first, kv.second);
-        } else {
-            for (auto &kv : items) insert(kv.first, kv.second);
-        }
-    }
+// Which duplicate survives a bulk build: the last one in input order
+// (insert semantics) or the first one (try_emplace semantics). A key already
+// in the map counts as coming before the input.
+enum class DedupPolicy { LastWins, FirstWins };
 
-private:
-    HashPolicy policy_;
-    KeyEqual eq_;
-    size_t capacity_;
-    std::vector<Slot<Key,Value>> table_;
-    size_t size_;
-    size_t deleted_count_;
-    double max_load_;
+// Scratch of the parallel bulk builds: hashes n items on up to `threads`
+// threads and partitions them stably by which of `regions` contiguous ranges
+// of a table with `slots` slots (or buckets) their index_of(hash) falls in.
+// hcs[i] is hash_of(i); order lists the items region by region, in input
+// order within each, and region r is order[begin[r], begin[r + 1]). That is
+// two words per item (16 B on 64-bit targets) on top of the input, until the
+// build returns; callers short of memory can load in slices.
+struct BulkPartition {
+    std::vector<size_t> hcs, order, begin;
+    size_t regions, slots;
 
-    void rehash(size_t new_cap) {
-        new_cap = next_prime(std::max<size_t>(new_cap, 3));
-        std::vector<Slot<Key,Value>> old = std::move(table_);
-        table_.assign(new_cap, Slot<Key,Value>());
-        size_t old_capacity = capacity_;
-        capacity_ = new_cap;
-        size_ = 0;
-        deleted_count_ = 0;
-        for (size_t i = 0; i < old_capacity; ++i) {
-            if (old[i].state == SlotState::Occupied) {
-                insert(old[i].key, old[i].value);
+    template <typename HashOf, typename IndexOf>
+    BulkPartition(size_t n, size_t regions, size_t slots, size_t threads, HashOf&& hash_of, IndexOf&& index_of)
+        : hcs(n), order(n), begin(regions + 1, 0), regions(regions), slots(slots) {
+        auto region_of = [&](size_t hc) { return static_cast<size_t>(uint64_t(index_of(hc)) * regions / slots); };
+        // 1. hash + per-chunk histograms of regions
+        const size_t chunks = threads;
+        std::vector<size_t> offsets(chunks * regions, 0);
+        auto chunk_begin = [&](size_t c) { return c * n / chunks; };
+        parallel_for(chunks, threads, [&](size_t c) {
+            size_t* hist = &offsets[c * regions];
+            for (size_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+                hcs[i] = hash_of(i);
+                ++hist[region_of(hcs[i])];
             }
+        });
+        // 2. exclusive prefix sum in (region, chunk) order keeps the scatter stable
+        for (size_t r = 0, sum = 0; r < regions; ++r) {
+            begin[r] = sum;
+            for (size_t c = 0; c < chunks; ++c) {
+                size_t cnt = offsets[c * regions + r];
+                offsets[c * regions + r] = sum;
+                sum += cnt;
+            }
+            begin[r + 1] = sum;
         }
+        parallel_for(chunks, threads, [&](size_t c) {
+            size_t* off = &offsets[c * regions];
+            for (size_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) order[off[region_of(hcs[i])]++] = i;
+        });
     }
+
+    // first index of region r + 1, i.e. one past the slots region r may fill
+    size_t end(size_t r) const { return r + 1 == regions ? slots : (slots * (r + 1) + regions - 1) / regions; }
 };
 
 // -----------------------------
-// Quadratic probing map (hi = h + c1*i + c2*i^2)
+// Introspection: every map has stats(), returning a HashMapStats snapshot.
+// The structural part is computed from the table when stats() is called. The
+// operation counters are only collected in HASHING_STATS builds; otherwise
+// OpStats is an empty type whose calls compile away and they stay zero.
+// "Probes" are whatever a map's lookups step through: slots for the probing
+// maps, nodes for chaining, groups for SwissHashMap, buckets for cuckoo.
 // -----------------------------
-template <
-    typename Key,
-    typename Value,
-    typename HashPolicy = DivisionHash<Key>,
-    typename KeyEqual = std::equal_to<Key>
->
-class QuadraticProbingHashMap {
+struct HashMapStats {
+    static constexpr size_t kHistogramSize = 33; // [i]: ops with i probes; last: 32 or more
+
+    size_t size = 0;
+    size_t capacity = 0;          // slots (buckets for ChainingHashMap)
+    double load_factor = 0.0;
+    size_t tombstones = 0;
+    double tombstone_ratio = 0.0; // tombstones / capacity
+    size_t longest_chain = 0;     // longest run of non-empty slots / longest bucket chain
+
+    bool collected = HASHING_STATS != 0;
+    uint64_t operations = 0;      // lookups, inserts and erases
+    uint64_t probes = 0;
+    uint64_t max_probe = 0;
+    std::array<uint64_t, kHistogramSize> probe_histogram{};
+    uint64_t rehashes = 0;
+    double rehash_seconds = 0.0;
+
+    double avg_probe() const noexcept { return operations ? double(probes) / double(operations) : 0.0; }
+};
+
+#if HASHING_STATS
+// Relaxed atomics: const lookups record too, possibly from several readers.
+class OpStats {
 public:
-    using key_type = Key;
-    using mapped_type = Value;
+    OpStats() = default;
+    OpStats(const OpStats& o) noexcept { *this = o; }
+    OpStats& operator=(const OpStats& o) noexcept {
+        for (size_t i = 0; i < HashMapStats::kHistogramSize; ++i) hist_[i].store(o.hist_[i].load(kRelaxed), kRelaxed);
+        probes_.store(o.probes_.load(kRelaxed), kRelaxed);
+        max_probe_.store(o.max_probe_.load(kRelaxed), kRelaxed);
+        rehashes_.store(o.rehashes_.load(kRelaxed), kRelaxed);
+        rehash_ns_.store(o.rehash_ns_.load(kRelaxed), kRelaxed);
+        return *this;
+    }
 
-    QuadraticProbingHashMap(size_t initial_capacity = 17, double max_load = 0.5, size_t c1 = 1, size_t c2 = 1)
-        : policy_(), eq_(), size_(0), deleted_count_(0), c1_(c1), c2_(c2), max_load_(max_load) {
-        // good practice: odd prime capacity helps quadratic sequences
-        capacity_ = next_prime(std::max<size_t>(initial_capacity, 3));
-        table_.assign(capacity_, Slot<Key,Value>());
+    void record(size_t probes) const noexcept {
+        hist_[std::min(probes, HashMapStats::kHistogramSize - 1)].fetch_add(1, kRelaxed);
+        probes_.fetch_add(probes, kRelaxed);
+        uint64_t m = max_probe_.load(kRelaxed);
+        while (probes > m && !max_probe_.compare_exchange_weak(m, probes, kRelaxed)) {}
     }
 
-    bool insert(const Key& k, const Value& v) {
-        if ((size_ + deleted_count_ + 1) > static_cast<size_t>(capacity_ * max_load_))
-            rehash(next_prime(capacity_ * 2));
+    // Counts the steps of one operation and records them when it goes out of scope.
+    class Probe {
+    public:
+        explicit Probe(const OpStats& s) noexcept : s_(s) {}
+        ~Probe() { s_.record(n_); }
+        void step() noexcept { ++n_; }
+    private:
+        const OpStats& s_;
+        size_t n_ = 0;
+    };
 
-        size_t h = policy_(k, capacity_);
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h + c1_*i + c2_*i*i) % capacity_;
-            auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) {
-                slot.key = k; slot.value = v; slot.state = SlotState::Occupied; ++size_; return true;
-            } else if (slot.state == SlotState::Deleted) {
-                slot.key = k; slot.value = v; slot.state = SlotState::Occupied; ++size_; --deleted_count_; return true;
-            } else if (slot.state == SlotState::Occupied && eq_(slot.key, k)) {
-                slot.value = v; return false;
-            }
+    // Times one rehash.
+    class Rehash {
+    public:
+        explicit Rehash(const OpStats& s) noexcept : s_(s), start_(std::chrono::steady_clock::now()) {}
+        ~Rehash() {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+            s_.rehashes_.fetch_add(1, kRelaxed);
+            s_.rehash_ns_.fetch_add(static_cast<uint64_t>(ns.count()), kRelaxed);
         }
-        rehash(next_prime(capacity_ * 2)); // should be rare
-        return insert(k, v);
-    }
+    private:
+        const OpStats& s_;
+        std::chrono::steady_clock::time_point start_;
+    };
 
-    std::optional<Value> find(const Key& k) const {
-        size_t h = policy_(k, capacity_);
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h + c1_*i + c2_*i*i) % capacity_;
-            const auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) return std::nullopt;
-            if (slot.state == SlotState::Occupied && eq_(slot.key, k)) return slot.value;
+    void fill(HashMapStats& out) const noexcept {
+        for (size_t i = 0; i < HashMapStats::kHistogramSize; ++i) {
+            out.probe_histogram[i] += hist_[i].load(kRelaxed);
+            out.operations += hist_[i].load(kRelaxed);
         }
-        return std::nullopt;
+        out.probes += probes_.load(kRelaxed);
+        out.max_probe = std::max<uint64_t>(out.max_probe, max_probe_.load(kRelaxed));
+        out.rehashes += rehashes_.load(kRelaxed);
+        out.rehash_seconds += double(rehash_ns_.load(kRelaxed)) * 1e-9;
     }
+    void reset() noexcept { *this = OpStats(); }
 
-    bool contains(const Key& k) const { return static_cast<bool>(find(k)); }
+private:
+    static constexpr std::memory_order kRelaxed = std::memory_order_relaxed;
+    mutable std::atomic<uint64_t> hist_[HashMapStats::kHistogramSize] = {};
+    mutable std::atomic<uint64_t> probes_{0}, max_probe_{0}, rehashes_{0}, rehash_ns_{0};
+};
+#else
+struct OpStats {
+    void record(size_t) const noexcept {}
+    struct Probe {
+        explicit Probe(const OpStats&) noexcept {}
+        void step() noexcept {}
+    };
+    struct Rehash {
+        explicit Rehash(const OpStats&) noexcept {}
+    };
+    void fill(HashMapStats&) const noexcept {}
+    void reset() noexcept {}
+};
+#endif
 
-    bool erase(const Key& k) {
-        size_t h = policy_(k, capacity_);
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h + c1_*i + c2_*i*i) % capacity_;
-            auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) return false;
-            if (slot.state == SlotState::Occupied && eq_(slot.key, k)) {
-                slot.state = SlotState::Deleted; --size_; ++deleted_count_; return true;
-            }
-        }
-        return false;
+// Longest circular run of slots i in [0, n) with busy(i).
+template <typename F>
+size_t longest_run(size_t n, F&& busy) {
+    const size_t none = static_cast<size_t>(-1);
+    size_t best = 0, cur = 0, head = none; // head: run at the start, joins the one at the end
+    for (size_t i = 0; i < n; ++i) {
+        if (busy(i)) { ++cur; continue; }
+        if (head == none) head = cur;
+        best = std::max(best, cur);
+        cur = 0;
     }
+    return head == none ? n : std::max(best, cur + head);
+}
 
-    size_t size() const noexcept { return size_; }
-    void clear() noexcept { table_.assign(capacity_, Slot<Key,Value>()); size_ = 0; deleted_count_ = 0; }
+// Fills the structural part of a HashMapStats.
+inline void fill_structure(HashMapStats& s, size_t size, size_t capacity, size_t tombstones, size_t longest) {
+    s.size = size;
+    s.capacity = capacity;
+    s.load_factor = capacity ? double(size) / double(capacity) : 0.0;
+    s.tombstones = tombstones;
+    s.tombstone_ratio = capacity ? double(tombstones) / double(capacity) : 0.0;
+    s.longest_chain = longest;
+}
 
-    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
-        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
-        std::vector<std::pair<Key,Value>> tmp = items;
-        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
-        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
-        for (auto &kv : tmp) insert(kv.first, kv.second);
-    }
+// -----------------------------
+// Capacity policies: choose legal table sizes and turn a hash policy result
+// into a slot index. Interface (conceptual):
+// struct CapacityPolicy {
+//   static constexpr bool power_of_two;
+//   size_t round_up(size_t n) const;  // smallest legal capacity >= n
+//   void reset(size_t capacity);      // called whenever the table is (re)sized
+//   size_t modulus() const;           // `mod` handed to the hash policy
+//   size_t index(size_t h) const;     // hash policy result -> home slot
+//   size_t wrap(size_t i) const;      // probe position -> [0, capacity)
+//   size_t step(size_t h2) const;     // double-hashing step that visits every slot
+// };
+// -----------------------------
 
-private:
-    HashPolicy policy_;
-    KeyEqual eq_;
-    size_t capacity_;
-    std::vector<Slot<Key,Value>> table_;
-    size_t size_;
-    size_t deleted_count_;
-    size_t c1_, c2_;
-    double max_load_;
+// Prime capacities (classic textbook sizing): the hash policy reduces mod the
+// capacity itself and every probe step is a `%`.
+struct PrimeCapacity {
+    static constexpr bool power_of_two = false;
+    size_t cap = 1;
+    size_t round_up(size_t n) const { return next_prime(std::max<size_t>(n, 3)); }
+    void reset(size_t capacity) noexcept { cap = capacity; }
+    size_t modulus() const noexcept { return cap; }
+    size_t index(size_t h) const noexcept { return h; }
+    size_t wrap(size_t i) const noexcept { return i % cap; }
+    size_t step(size_t h2) const noexcept { return h2 == 0 ? 1 : h2; }
+};
 
-    void rehash(size_t new_cap) {
-        new_cap = next_prime(std::max<size_t>(new_cap, 3));
-        std::vector<Slot<Key,Value>> old = std::move(table_);
-        size_t oldcap = capacity_;
-        capacity_ = new_cap;
-        table_.assign(capacity_, Slot<Key,Value>());
-        size_ = 0; deleted_count_ = 0;
-        for (size_t i = 0; i < oldcap; ++i) if (old[i].state == SlotState::Occupied) insert(old[i].key, old[i].value);
+// Hash range used by the power-of-two policies: the hash policy reduces into
+// [0, 2^31-1) once per operation, independent of the capacity. Hash policies
+// must reduce in a type wide enough for it (DivisionHash works in 64 bits),
+// not in Key.
+constexpr size_t kHashRange = 2147483647ULL;
+
+// Power-of-two capacities, low bits of the hash pick the slot: probe steps are
+// a single AND. Best with hash policies that already mix well.
+struct PowerOfTwoMaskCapacity {
+    static constexpr bool power_of_two = true;
+    size_t mask = 0;
+    size_t round_up(size_t n) const { return next_pow2(std::max<size_t>(n, 4)); }
+    void reset(size_t capacity) noexcept { mask = capacity - 1; }
+    size_t modulus() const noexcept { return kHashRange; }
+    size_t index(size_t h) const noexcept { return h & mask; }
+    size_t wrap(size_t i) const noexcept { return i & mask; }
+    size_t step(size_t h2) const noexcept { return h2 | 1; } // odd steps cycle through 2^k slots
+};
+
+// Power-of-two capacities with Fibonacci hashing: multiply by 2^64/phi and keep
+// the top bits, which scatters patterned keys (e.g. DivisionHash on strided ids)
+// before masking.
+struct PowerOfTwoFibonacciCapacity {
+    static constexpr bool power_of_two = true;
+    size_t mask = 0;
+    unsigned shift = 63;
+    size_t round_up(size_t n) const { return next_pow2(std::max<size_t>(n, 4)); }
+    void reset(size_t capacity) noexcept {
+        mask = capacity - 1;
+        shift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1) --shift;
     }
+    size_t modulus() const noexcept { return kHashRange; }
+    size_t index(size_t h) const noexcept {
+        return static_cast<size_t>((static_cast<uint64_t>(h) * 11400714819323198485ULL) >> shift);
+    }
+    size_t wrap(size_t i) const noexcept { return i & mask; }
+    size_t step(size_t h2) const noexcept { return h2 | 1; }
 };
 
 // -----------------------------
-// Double Hashing map: hi = (h1 + i * h2) mod M
+// Allocators. Every map takes an Allocator (any value_type; it is rebound to
+// each array the map keeps) and hands it to all of its long-lived storage, so
+// std::pmr::polymorphic_allocator or HugePageAllocator below place whole
+// tables. Short-lived scratch buffers of rehash and bulk builds use the
+// default heap. The pmr:: aliases at the end of the file pick
+// polymorphic_allocator.
 // -----------------------------
-template <
-    typename Key,
-    typename Value,
-    typename HashPolicy1 = DivisionHash<Key>,
-    typename HashPolicy2 = DivisionHash<Key>,
-    typename KeyEqual = std::equal_to<Key>
->
-class DoubleHashingHashMap {
+template <typename Alloc, typename T>
+using rebind_alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+template <typename T, typename Alloc>
+using alloc_vector = std::vector<T, rebind_alloc_t<Alloc, T>>;
+
+// Maps blocks of at least 2 MB with mmap, aligned to 2 MB and advised
+// MADV_HUGEPAGE, so transparent huge pages back them: one TLB entry per 2 MB
+// instead of 512. With numa_node >= 0 the range is also mbind()-ed to that
+// node before first touch (Linux only; elsewhere the node is ignored).
+// Smaller blocks, and every block on systems without mmap, come from
+// std::allocator: a table that small does not miss in the TLB.
+template <typename T>
+class HugePageAllocator {
 public:
-    DoubleHashingHashMap(size_t initial_capacity = 17, double max_load = 0.6)
-        : hp1_(), hp2_(), eq_(), size_(0), deleted_count_(0), max_load_(max_load) {
-        capacity_ = next_prime(std::max<size_t>(initial_capacity, 3));
-        table_.assign(capacity_, Slot<Key,Value>());
-    }
+    using value_type = T;
+    static constexpr size_t kHugePage = size_t(2) << 20;
+    static constexpr int kMaxNodes = 1024;
 
-    bool insert(const Key& k, const Value& v) {
-        if ((size_ + deleted_count_ + 1) > static_cast<size_t>(capacity_ * max_load_))
-            rehash(next_prime(capacity_ * 2));
-        size_t h1 = hp1_(k, capacity_);
-        size_t h2 = hp2_.second ? hp2_.second(k, capacity_) : hp2_(k, capacity_);
-        if (h2 == 0) h2 = 1;
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h1 + i * h2) % capacity_;
-            auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) {
-                slot.key = k; slot.value = v; slot.state = SlotState::Occupied; ++size_; return true;
-            } else if (slot.state == SlotState::Deleted) {
-                slot.key = k; slot.value = v; slot.state = SlotState::Occupied; ++size_; --deleted_count_; return true;
-            } else if (slot.state == SlotState::Occupied && eq_(slot.key, k)) {
-                slot.value = v; return false;
-            }
-        }
-        rehash(next_prime(capacity_ * 2));
-        return insert(k, v);
+    explicit HugePageAllocator(int numa_node = -1) : node_(numa_node) {
+        if (numa_node >= kMaxNodes) throw std::invalid_argument("HugePageAllocator: NUMA node out of range");
     }
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>& other) noexcept : node_(other.numa_node()) {}
 
-    std::optional<Value> find(const Key& k) const {
-        size_t h1 = hp1_(k, capacity_);
-        size_t h2 = hp2_.second ? hp2_.second(k, capacity_) : hp2_(k, capacity_);
-        if (h2 == 0) h2 = 1;
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h1 + i * h2) % capacity_;
-            const auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) return std::nullopt;
-            if (slot.state == SlotState::Occupied && eq_(slot.key, k)) return slot.value;
+    int numa_node() const noexcept { return node_; }
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+#if defined(HASHING_HAVE_MMAP)
+        if (n * sizeof(T) >= kHugePage) return static_cast<T*>(map(n * sizeof(T)));
+#endif
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) noexcept {
+#if defined(HASHING_HAVE_MMAP)
+        if (n * sizeof(T) >= kHugePage) {
+            munmap(p, round_up(n * sizeof(T)));
+            return;
         }
-        return std::nullopt;
+#endif
+        std::allocator<T>().deallocate(p, n);
     }
 
-    bool erase(const Key& k) {
-        size_t h1 = hp1_(k, capacity_);
-        size_t h2 = hp2_.second ? hp2_.second(k, capacity_) : hp2_(k, capacity_);
-        if (h2 == 0) h2 = 1;
-        for (size_t i = 0; i < capacity_; ++i) {
-            size_t idx = (h1 + i * h2) % capacity_;
-            auto &slot = table_[idx];
-            if (slot.state == SlotState::Empty) return false;
-            if (slot.state == SlotState::Occupied && eq_(slot.key, k)) {
-                slot.state = SlotState::Deleted; --size_; ++deleted_count_; return true;
+    friend bool operator==(const HugePageAllocator& a, const HugePageAllocator& b) noexcept { return a.node_ == b.node_; }
+    friend bool operator!=(const HugePageAllocator& a, const HugePageAllocator& b) noexcept { return a.node_ != b.node_; }
+
+private:
+    int node_;
+
+    static size_t round_up(size_t bytes) noexcept { return (bytes + kHugePage - 1) & ~(kHugePage - 1); }
+
+#if defined(HASHING_HAVE_MMAP)
+    void* map(size_t bytes) const {
+        size_t len = round_up(bytes);
+        // over-map by one huge page, then trim both ends to a 2 MB boundary
+        void* raw = mmap(nullptr, len + kHugePage, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t start = (base + kHugePage - 1) & ~uintptr_t(kHugePage - 1);
+        if (start != base) munmap(raw, start - base);
+        munmap(reinterpret_cast<void*>(start + len), base + kHugePage - start);
+        void* p = reinterpret_cast<void*>(start);
+#if defined(MADV_HUGEPAGE)
+        madvise(p, len, MADV_HUGEPAGE);
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+        if (node_ >= 0) {
+            unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {};
+            mask[node_ / (8 * sizeof(unsigned long))] = 1UL << (node_ % (8 * sizeof(unsigned long)));
+            const int kMpolBind = 2; // MPOL_BIND, without needing <numaif.h>
+            if (syscall(SYS_mbind, p, len, kMpolBind, mask, kMaxNodes + 1, 0) != 0) {
+                munmap(p, len);
+                throw std::runtime_error("HugePageAllocator: cannot bind to NUMA node " + std::to_string(node_));
             }
         }
-        return false;
+#endif
+        return p;
     }
+#endif
+};
 
-    bool contains(const Key& k) const { return static_cast<bool>(find(k)); }
-    size_t size() const noexcept { return size_; }
-    void clear() noexcept { table_.assign(capacity_, Slot<Key,Value>()); size_ = 0; deleted_count_ = 0; }
+// -----------------------------
+// Generic probing-map base helpers
+// -----------------------------
 
-    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
-        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
-        std::vector<std::pair<Key,Value>> tmp = items;
-        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
-        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
-        for (auto &kv : tmp) insert(kv.first, kv.second);
-    }
+enum class SlotState : uint8_t { Empty = 0, Occupied = 1, Deleted = 2 };
 
-private:
-    HashPolicy1 hp1_;
+// A utility slot storing key/value and state
+template <typename Key, typename Value>
+struct Slot {
+    SlotState state;
+    Key key;
+    Value value;
+    Slot() : state(SlotState::Empty), key(), value() {}
+};
+
+// -----------------------------
+// Slot storage layouts for the probing maps. Layout::storage<Key,Value,Alloc>
+// is constructed from the map's allocator and exposes
+//   assign(n), capacity(), state(i) / set_state(i, s), key(i), value(i),
+//   prefetch(i) (the lines a probe reads first at slot i),
+//   reserve(n) / extend(k) (set up a table k empty slots at a time, for
+//   incremental rehash)
+// so the probing code does not depend on how slots are laid out in memory.
+// -----------------------------
+
+// Array of structs (default): state, key and value side by side in one Slot.
+struct AoSLayout {
+    static constexpr bool caches_hash = false;
+    template <typename Key, typename Value, typename Alloc = std::allocator<Slot<Key,Value>>>
+    struct storage {
+        alloc_vector<Slot<Key,Value>, Alloc> slots;
+        explicit storage(const Alloc& a = Alloc()) : slots(a) {}
+        // clear + resize default-constructs in place: no copies, so move-only
+        // keys and values are fine
+        void assign(size_t n) { slots.clear(); slots.resize(n); }
+        void reserve(size_t n) { slots.reserve(n); }
+        void extend(size_t k) { slots.resize(slots.size() + k); }
+        size_t capacity() const noexcept { return slots.size(); }
+        SlotState state(size_t i) const noexcept { return slots[i].state; }
+        void set_state(size_t i, SlotState s) noexcept { slots[i].state = s; }
+        Key& key(size_t i) noexcept { return slots[i].key; }
+        const Key& key(size_t i) const noexcept { return slots[i].key; }
+        Value& value(size_t i) noexcept { return slots[i].value; }
+        const Value& value(size_t i) const noexcept { return slots[i].value; }
+        void prefetch(size_t i) const noexcept { ::prefetch(&slots[i]); }
+    };
+};
+
+// Structure of arrays: separate dense arrays for states, keys and values. A
+// probe walks only the 1-byte states and the keys; the value array is read once
+// on a hit, so large values no longer dilute the cache lines a probe touches.
+struct SoALayout {
+    static constexpr bool caches_hash = false;
+    template <typename Key, typename Value, typename Alloc = std::allocator<Slot<Key,Value>>>
+    struct storage {
+        alloc_vector<SlotState, Alloc> states;
+        alloc_vector<Key, Alloc> keys;
+        alloc_vector<Value, Alloc> values;
+        explicit storage(const Alloc& a = Alloc()) : states(a), keys(a), values(a) {}
+        void assign(size_t n) {
+            states.assign(n, SlotState::Empty);
+            keys.clear(); keys.resize(n);
+            values.clear(); values.resize(n);
+        }
+        void reserve(size_t n) { states.reserve(n); keys.reserve(n); values.reserve(n); }
+        void extend(size_t k) {
+            states.resize(states.size() + k, SlotState::Empty);
+            keys.resize(keys.size() + k);
+            values.resize(values.size() + k);
+        }
+        size_t capacity() const noexcept { return states.size(); }
+        SlotState state(size_t i) const noexcept { return states[i]; }
+        void set_state(size_t i, SlotState s) noexcept { states[i] = s; }
+        Key& key(size_t i) noexcept { return keys[i]; }
+        const Key& key(size_t i) const noexcept { return keys[i]; }
+        Value& value(size_t i) noexcept { return values[i]; }
+        const Value& value(size_t i) const noexcept { return values[i]; }
+        void prefetch(size_t i) const noexcept {
+            ::prefetch(&states[i]);
+            ::prefetch(&keys[i]);
+        }
+    };
+};
+
+// Wraps another layout and stores each element's full hash next to it. Probes
+// compare the cached hash before calling KeyEqual, and resizes place elements
+// by their cached hash instead of hashing every key again; the maps switch
+// to a capacity-independent hash (policy(k, kHashRange)) to make that valid.
+// Worth it for expensive keys such as strings.
+template <typename Base = AoSLayout>
+struct CachedHashLayout {
+    static constexpr bool caches_hash = true;
+    template <typename Key, typename Value, typename Alloc = std::allocator<Slot<Key,Value>>>
+    struct storage : Base::template storage<Key,Value,Alloc> {
+        alloc_vector<size_t, Alloc> hashes;
+        explicit storage(const Alloc& a = Alloc()) : Base::template storage<Key,Value,Alloc>(a), hashes(a) {}
+        void assign(size_t n) {
+            Base::template storage<Key,Value,Alloc>::assign(n);
+            hashes.assign(n, 0);
+        }
+        void reserve(size_t n) {
+            Base::template storage<Key,Value,Alloc>::reserve(n);
+            hashes.reserve(n);
+        }
+        void extend(size_t k) {
+            Base::template storage<Key,Value,Alloc>::extend(k);
+            hashes.resize(hashes.size() + k, 0);
+        }
+        size_t hash(size_t i) const noexcept { return hashes[i]; }
+        void set_hash(size_t i, size_t h) noexcept { hashes[i] = h; }
+        void prefetch(size_t i) const noexcept {
+            Base::template storage<Key,Value,Alloc>::prefetch(i);
+            ::prefetch(&hashes[i]);
+        }
+    };
+};
+
+// -----------------------------
+// Tombstone purge and shrinking for the probing maps
+// -----------------------------
+
+// In-place tombstone purge of a SlotState table; no second table is
+// allocated. Tombstones become empty and every element is re-placed at the
+// first free slot of its own probe sequence, where elements not re-placed yet
+// count as free: taking such a slot swaps the two, and the displaced element
+// is handled next. first_free(i, is_free) returns the first slot j on the
+// probe sequence of the element in slot i with is_free(j), or npos; elements
+// with none (a sequence that misses part of the table) are moved out and
+// returned for the caller to insert again.
+template <typename Key, typename Value, bool CachesHash, typename Storage, typename FirstFree>
+std::vector<std::pair<Key,Value>> purge_tombstones_in_place(Storage& t, size_t capacity, FirstFree&& first_free) {
+    constexpr size_t npos = static_cast<size_t>(-1);
+    std::vector<std::pair<Key,Value>> stranded;
+    std::vector<bool> pending(capacity, false);
+    for (size_t i = 0; i < capacity; ++i) {
+        if (t.state(i) == SlotState::Deleted) t.set_state(i, SlotState::Empty);
+        else if (t.state(i) == SlotState::Occupied) pending[i] = true;
+    }
+    auto is_free = [&](size_t j) { return pending[j] || t.state(j) == SlotState::Empty; };
+    for (size_t i = 0; i < capacity; ++i) {
+        while (pending[i]) {
+            size_t j = first_free(i, is_free);
+            if (j == i) {
+                pending[i] = false;
+            } else if (j == npos) {
+                stranded.emplace_back(std::move(t.key(i)), std::move(t.value(i)));
+                t.set_state(i, SlotState::Empty);
+                pending[i] = false;
+            } else if (t.state(j) == SlotState::Empty) {
+                t.key(j) = std::move(t.key(i));
+                t.value(j) = std::move(t.value(i));
+                t.set_state(j, SlotState::Occupied);
+                if constexpr (CachesHash) t.set_hash(j, t.hash(i));
+                t.set_state(i, SlotState::Empty);
+                pending[i] = false;
+            } else {
+                using std::swap;
+                swap(t.key(i), t.key(j));
+                swap(t.value(i), t.value(j));
+                if constexpr (CachesHash) {
+                    size_t h = t.hash(i);
+                    t.set_hash(i, t.hash(j));
+                    t.set_hash(j, h);
+                }
+                pending[j] = false;
+            }
+        }
+    }
+    return stranded;
+}
+
+// Hash bookkeeping of the open-addressing maps (linear, quadratic, double
+// hashing), given the map's hash policy and the capacity it hashes for.
+template <typename Layout, typename CapacityPolicy, typename HashPolicy>
+struct SlotHashing {
+    static constexpr bool kCachedHash = Layout::caches_hash;
+
+    // Full hash of k. With a hash-caching layout it does not depend on the
+    // capacity, so the copy kept in the slot survives resizes.
+    template <typename K>
+    static size_t hash_of(const HashPolicy& p, const K& k, const CapacityPolicy& cap) {
+        return p(k, kCachedHash ? kHashRange : cap.modulus());
+    }
+    static size_t home_of(size_t h, const CapacityPolicy& cap, size_t capacity) {
+        if constexpr (kCachedHash && !CapacityPolicy::power_of_two) return cap.index(h % capacity);
+        else return cap.index(h);
+    }
+
+    // cached hashes reject most non-matching slots without calling KeyEqual
+    template <typename Storage>
+    static bool hash_matches(const Storage& t, size_t idx, size_t h) noexcept {
+        if constexpr (kCachedHash) return t.hash(idx) == h;
+        else return true;
+    }
+    template <typename Storage>
+    static void store_hash(Storage& t, size_t idx, size_t h) noexcept {
+        if constexpr (kCachedHash) t.set_hash(idx, h);
+    }
+    // hash of an element moved by a resize: cached, or recomputed for cap
+    template <typename Storage>
+    static size_t moved_hash(const HashPolicy& p, const Storage& t, size_t idx, const CapacityPolicy& cap) {
+        if constexpr (kCachedHash) return t.hash(idx);
+        else return hash_of(p, t.key(idx), cap);
+    }
+};
+
+// Capacity (before rounding) that holds n elements at half of max_load, where
+// a doubling leaves a table; used by the auto-shrink on erase.
+inline size_t shrink_capacity(size_t n, double max_load) {
+    return std::max<size_t>(static_cast<size_t>(2 * n / max_load) + 1, 16);
+}
+
+// set_shrink_load(min_load): 0 disables auto-shrink, and a shrink must leave
+// the load above min_load or the next erase would shrink again.
+inline void check_shrink_load(double min_load, double max_load) {
+    if (!(min_load >= 0.0 && min_load < max_load / 2))
+        throw std::invalid_argument("shrink load must be in [0, max_load / 2)");
+}
+
+// -----------------------------
+// Snapshot files (LinearProbingHashMap::save / open)
+// Layout: SnapshotHeader, then the state (1 byte per slot), key, value and,
+// for hash-caching layouts, hash arrays as raw bytes, each starting on a
+// 64-byte boundary. A file is only meaningful to the same map instantiation
+// (hash policy and seed, capacity policy) on a machine with the same byte
+// order and type layout; the header checks what it can.
+// -----------------------------
+struct SnapshotHeader {
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kPowerOfTwo = 1;
+    static constexpr uint32_t kCachedHash = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t key_size, value_size, hash_size;
+    uint64_t capacity, size;
+    uint64_t states_off, keys_off, values_off, hashes_off, file_size;
+
+    static uint64_t align(uint64_t off) noexcept { return (off + 63) & ~uint64_t(63); }
+
+    static SnapshotHeader make(size_t key_size, size_t value_size, size_t capacity, size_t size, uint32_t flags) {
+        SnapshotHeader h{};
+        std::memcpy(h.magic, "HMAPSNAP", 8);
+        h.version = kVersion;
+        h.flags = flags;
+        h.key_size = key_size;
+        h.value_size = value_size;
+        h.hash_size = (flags & kCachedHash) ? sizeof(size_t) : 0;
+        h.capacity = capacity;
+        h.size = size;
+        h.states_off = align(sizeof(SnapshotHeader));
+        h.keys_off = align(h.states_off + capacity);
+        h.values_off = align(h.keys_off + capacity * key_size);
+        uint64_t end = h.values_off + capacity * value_size;
+        if (flags & kCachedHash) {
+            h.hashes_off = align(end);
+            end = h.hashes_off + capacity * h.hash_size;
+        }
+        h.file_size = end;
+        return h;
+    }
+
+    // same shape as `expect` (everything but capacity/size) and self-consistent
+    bool compatible(const SnapshotHeader& expect, uint64_t actual_size) const noexcept {
+        if (std::memcmp(magic, expect.magic, 8) != 0 || version != expect.version || flags != expect.flags ||
+            key_size != expect.key_size || value_size != expect.value_size || hash_size != expect.hash_size)
+            return false;
+        if (size > capacity || capacity > actual_size) return false;
+        SnapshotHeader want = make(key_size, value_size, capacity, size, flags);
+        return states_off == want.states_off && keys_off == want.keys_off && values_off == want.values_off &&
+               hashes_off == want.hashes_off && file_size == want.file_size && file_size <= actual_size;
+    }
+};
+
+// Buffered binary writer that tracks its offset so sections can be padded.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path) : out_(path, std::ios::binary | std::ios::trunc) {
+        if (!out_) throw std::runtime_error("cannot create snapshot: " + path);
+        buf_.reserve(kBuffer);
+    }
+    void write(const void* p, size_t n) {
+        const char* c = static_cast<const char*>(p);
+        buf_.insert(buf_.end(), c, c + n);
+        pos_ += n;
+        if (buf_.size() >= kBuffer) flush();
+    }
+    void pad_to(uint64_t off) {
+        if (off > pos_) buf_.resize(buf_.size() + (off - pos_), 0);
+        pos_ = std::max<uint64_t>(pos_, off);
+    }
+    void finish() {
+        flush();
+        out_.flush();
+        if (!out_) throw std::runtime_error("snapshot write failed");
+    }
+
+private:
+    static constexpr size_t kBuffer = size_t(1) << 20;
+    std::ofstream out_;
+    std::vector<char> buf_;
+    uint64_t pos_ = 0;
+
+    void flush() {
+        out_.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+        buf_.clear();
+    }
+};
+
+// Read-only view of a whole file: mmap where available (pages come straight
+// from the page cache, nothing is parsed), otherwise read into memory.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#if defined(HASHING_HAVE_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open snapshot: " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat snapshot: " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_) {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot map snapshot: " + path);
+            }
+            ::madvise(p, size_, MADV_RANDOM); // hash lookups: readahead only wastes page cache
+            data_ = static_cast<const unsigned char*>(p);
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) throw std::runtime_error("cannot open snapshot: " + path);
+        size_ = static_cast<size_t>(in.tellg());
+        buffer_.reset(new uint64_t[(size_ + 7) / 8]); // 8-byte aligned copy
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(buffer_.get()), static_cast<std::streamsize>(size_));
+        if (!in) throw std::runtime_error("cannot read snapshot: " + path);
+        data_ = reinterpret_cast<const unsigned char*>(buffer_.get());
+#endif
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept { swap(o); }
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        MappedFile tmp(std::move(o));
+        swap(tmp);
+        return *this;
+    }
+    ~MappedFile() {
+#if defined(HASHING_HAVE_MMAP)
+        if (data_) ::munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+    }
+
+    const unsigned char* data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#if !defined(HASHING_HAVE_MMAP)
+    std::unique_ptr<uint64_t[]> buffer_;
+#endif
+
+    void swap(MappedFile& o) noexcept {
+        std::swap(data_, o.data_);
+        std::swap(size_, o.size_);
+#if !defined(HASHING_HAVE_MMAP)
+        std::swap(buffer_, o.buffer_);
+#endif
+    }
+};
+
+template <typename Key, typename Value, typename HashPolicy, typename KeyEqual,
+          typename CapacityPolicy, bool CachedHash>
+class MappedLinearProbingHashMap;
+
+// -----------------------------
+// Map interface. The maps below share these members; class comments only
+// note where one differs.
+//   insert(k, v)             insert or assign; true if k was new
+//   emplace(k, args...)      the same, building the value from args
+//   try_emplace(k, args...)  insert only if k is absent; args are left
+//                            untouched otherwise
+//   find(k)                  copy of the stored value, or std::nullopt
+//   find_ptr(k)              zero-copy: pointer to the stored value or
+//                            nullptr, valid until the map is next modified
+//   contains(k)              presence only; never touches the value
+//   for_each(f)              f(key, value) for every element, in no
+//                            particular order; the value is mutable through
+//                            a non-const map
+// find_ptr and contains also take any K that KeyEqual (and a map's Hasher,
+// where it has one) accepts as transparent, e.g. std::string_view against
+// std::string keys. The concurrent maps have no find_ptr: a pointer would
+// outlive the lock that keeps it valid.
+// Where a map supports them, it also has these sizing controls:
+//   reserve(n)               room for n elements in total without further
+//                            growth; maps with tombstones also drop them
+//   shrink_to_fit()          smallest table that holds the current elements
+//                            without growing
+//   set_shrink_load(min)     opt-in auto-shrink: once an erase leaves the
+//                            load below min, the table is rebuilt at half of
+//                            max_load. 0, the default, never shrinks; min
+//                            must be below max_load / 2
+//   purge_tombstones()       drops every tombstone in place (see
+//                            purge_tombstones_in_place): probes are as short
+//                            as after a rehash, without a second table.
+//                            Inserts do this instead of doubling when
+//                            tombstones outnumber elements, and so does erase
+//                            once they also fill a quarter of the table
+// -----------------------------
+
+// -----------------------------
+// Linear probing map
+// -----------------------------
+template <
+    typename Key,
+    typename Value,
+    typename HashPolicy = DivisionHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename CapacityPolicy = PrimeCapacity,
+    typename Layout = AoSLayout,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class LinearProbingHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hash_policy = HashPolicy;
+    using capacity_policy = CapacityPolicy;
+    using allocator_type = Allocator;
+    using storage_type = typename Layout::template storage<Key,Value,Allocator>;
+    using mapped_view = MappedLinearProbingHashMap<Key, Value, HashPolicy, KeyEqual, CapacityPolicy,
+                                                   Layout::caches_hash>;
+
+    explicit LinearProbingHashMap(size_t initial_capacity = 16, double max_load = 0.6,
+                                  const Allocator& alloc = Allocator())
+        : policy_(), eq_(), alloc_(alloc), table_(alloc), size_(0), deleted_count_(0), max_load_(max_load),
+          old_table_(alloc), next_table_(alloc) {
+        capacity_ = cap_.round_up(initial_capacity);
+        cap_.reset(capacity_);
+        table_.assign(capacity_);
+    }
+
+    bool insert(const Key& k, const Value& v) { return emplace_impl(k, true, v); }
+    bool insert(Key&& k, Value&& v) { return emplace_impl(std::move(k), true, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...); }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    const Value* find_ptr(const Key& k) const { return lookup(k); }
+    Value* find_ptr(const Key& k) { return const_cast<Value*>(lookup(k)); }
+
+    bool contains(const Key& k) const { return lookup(k) != nullptr; }
+
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return lookup(k); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    Value* find_ptr(const K& k) { return const_cast<Value*>(lookup(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return lookup(k) != nullptr; }
+
+    bool erase(const Key& k) {
+        if (rehashing()) rehash_step();
+        size_t idx = locate(k);
+        if (idx != npos) {
+            table_.set_state(idx, SlotState::Deleted);
+            // placement of key/value is optional; we leave them
+            ++deleted_count_;
+        } else if (old_capacity_ && (idx = locate_old(k)) != npos) {
+            // not migrated yet
+            old_table_.set_state(idx, SlotState::Deleted);
+        } else {
+            return false;
+        }
+        --size_;
+        after_erase();
+        return true;
+    }
+
+    size_t size() const noexcept { return size_; }
+    void clear() noexcept {
+        table_.assign(capacity_);
+        old_table_ = storage_type(alloc_);
+        old_capacity_ = migrate_left_ = 0;
+        next_table_ = storage_type(alloc_);
+        next_capacity_ = 0;
+        size_ = 0;
+        deleted_count_ = 0;
+    }
+
+    // Incremental rehash (opt-in). With slots_per_op > 0 a resize only
+    // allocates the new table. Each following insert/erase first sets up at
+    // least slots_per_op of its slots while the current table keeps serving,
+    // then migrates at least slots_per_op old slots, with lookups consulting
+    // both tables until the old one is drained. Both steps are raised as
+    // needed to finish before the next resize is due, so no single operation
+    // is O(n). 0 (the default) restores stop-the-world rehashing.
+    // Lookups are const and never migrate.
+    void set_incremental_rehash(size_t slots_per_op) {
+        if (slots_per_op == 0) finish_rehash();
+        migrate_step_ = slots_per_op;
+    }
+    bool rehashing() const noexcept { return old_capacity_ != 0 || next_capacity_ != 0; }
+    // Completes a pending incremental rehash.
+    void finish_rehash() {
+        if (next_capacity_) prepare(next_capacity_, capacity_);
+        migrate(old_capacity_);
+    }
+
+    // Finishes a pending incremental migration first.
+    void purge_tombstones() {
+        finish_rehash();
+        OpStats::Rehash timer(op_stats_);
+        purge_tombstones_in_place<Key, Value, kCachedHash>(table_, capacity_, [this](size_t i, auto&& is_free) {
+            size_t h = home_of(moved_hash(table_, i));
+            for (size_t n = 0;; ++n)
+                if (is_free(cap_.wrap(h + n))) return cap_.wrap(h + n);
+        });
+        deleted_count_ = 0;
+    }
+
+    // In incremental mode the shrunk table is migrated into like any resize.
+    void set_shrink_load(double min_load) {
+        check_shrink_load(min_load, max_load_);
+        shrink_load_ = min_load;
+    }
+
+    void shrink_to_fit() { rehash(static_cast<size_t>(size_ / max_load_) + 1); }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (table_.state(i) == SlotState::Occupied) f(table_.key(i), table_.value(i));
+        for (size_t i = 0; i < old_capacity_; ++i)
+            if (unmigrated(i) && old_table_.state(i) == SlotState::Occupied) f(old_table_.key(i), old_table_.value(i));
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (table_.state(i) == SlotState::Occupied) f(std::as_const(table_.key(i)), table_.value(i));
+        for (size_t i = 0; i < old_capacity_; ++i)
+            if (unmigrated(i) && old_table_.state(i) == SlotState::Occupied) f(std::as_const(old_table_.key(i)), old_table_.value(i));
+    }
+
+    // Load, tombstones and primary clustering (longest run of non-empty slots),
+    // plus the HASHING_STATS counters.
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size_, capacity_, deleted_count_,
+                       longest_run(capacity_, [this](size_t i) { return table_.state(i) != SlotState::Empty; }));
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return alloc_; }
+
+    // Batched lookup: out[i] = find_ptr(keys[i]). Keys are hashed and their
+    // home slots prefetched kBatch at a time before any of them is resolved,
+    // so the cache misses of a batch overlap instead of queueing up.
+    void find_batch(const Key* keys, size_t n, const Value** out) const {
+        find_batch_impl(keys, n, [out](size_t i, const Value* v) { out[i] = v; });
+    }
+    void find_batch(const Key* keys, size_t n, Value** out) {
+        find_batch_impl(keys, n, [out](size_t i, const Value* v) { out[i] = const_cast<Value*>(v); });
+    }
+
+    // Batched insert-or-assign of keys[i] -> values[i]; returns how many keys
+    // were new. The table is grown once per chunk, then the chunk is hashed
+    // and prefetched like find_batch. Incremental-rehash mode inserts one by
+    // one to keep its bounded per-operation work.
+    size_t insert_batch(const Key* keys, const Value* values, size_t n) {
+        size_t added = 0;
+        size_t hcs[kBatch];
+        for (size_t base = 0; base < n; base += kBatch) {
+            size_t m = std::min(kBatch, n - base);
+            if (migrate_step_ != 0) {
+                for (size_t j = 0; j < m; ++j) added += insert(keys[base + j], values[base + j]);
+                continue;
+            }
+            while ((size_ + deleted_count_ + m) > static_cast<size_t>(capacity_ * max_load_)) {
+                if (deleted_count_ > size_) purge_tombstones();
+                else rehash(capacity_ * 2);
+            }
+            for (size_t j = 0; j < m; ++j) {
+                hcs[j] = hash_of(keys[base + j]);
+                table_.prefetch(home_of(hcs[j]));
+            }
+            for (size_t j = 0; j < m; ++j)
+                added += emplace_hashed(keys[base + j], hcs[j], true, values[base + j]);
+        }
+        return added;
+    }
+
+    void reserve(size_t n) {
+        size_t want = cap_.round_up(static_cast<size_t>(n / max_load_) + 1);
+        if (want > capacity_) rehash(want);
+        else if (deleted_count_) purge_tombstones();
+    }
+
+    // Parallel bulk load. The table is presized once; items are hashed and
+    // radix-partitioned (stably, see BulkPartition for the scratch memory) by
+    // which contiguous region of the table their home slot falls in, and each
+    // worker fills its own regions with no locking. A probe that would leave
+    // its region is deferred and finished serially afterwards. Equal keys
+    // share a home, hence a region, so dedup follows input order exactly as
+    // documented for DedupPolicy.
+    void bulk_build(const std::vector<std::pair<Key,Value>>& items,
+                    DedupPolicy dedup = DedupPolicy::LastWins, size_t threads = 0) {
+        const bool assign = dedup == DedupPolicy::LastWins;
+        const size_t n = items.size();
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        finish_rehash();
+        reserve(size_ + n);
+        if (threads == 1 || n < 4 * kBulkRegion) {
+            for (const auto& kv : items) emplace_impl(kv.first, assign, kv.second);
+            return;
+        }
+
+        // 1. partition by region of the home slot
+        const size_t regions = std::max<size_t>(1, std::min(capacity_ / kBulkRegion, threads * 16));
+        BulkPartition part(n, regions, capacity_, threads, [&](size_t i) { return hash_of(items[i].first); },
+                           [&](size_t hc) { return home_of(hc); });
+        const std::vector<size_t>& hcs = part.hcs;
+
+        // 2. fill regions independently; slots past a region's end belong to
+        //    another worker, so those items wait in `deferred`
+        std::vector<std::vector<size_t>> deferred(regions);
+        std::vector<size_t> added(regions, 0);
+        parallel_for(regions, threads, [&](size_t r) {
+            size_t end = part.end(r);
+            for (size_t pos = part.begin[r]; pos < part.begin[r + 1]; ++pos) {
+                size_t i = part.order[pos];
+                size_t idx = home_of(hcs[i]);
+                for (; idx < end; ++idx) {
+                    if (table_.state(idx) == SlotState::Empty) break;
+                    if (hashing::hash_matches(table_, idx, hcs[i]) && eq_(table_.key(idx), items[i].first)) break;
+                }
+                if (idx == end) {
+                    deferred[r].push_back(i);
+                } else if (table_.state(idx) == SlotState::Occupied) {
+                    if (assign) table_.value(idx) = items[i].second;
+                } else {
+                    table_.key(idx) = items[i].first;
+                    table_.value(idx) = items[i].second;
+                    table_.set_state(idx, SlotState::Occupied);
+                    hashing::store_hash(table_, idx, hcs[i]);
+                    ++added[r];
+                }
+            }
+        });
+        for (size_t a : added) size_ += a;
+
+        // 3. stragglers, serially and in input order per key
+        for (size_t r = 0; r < regions; ++r)
+            for (size_t i : deferred[r]) emplace_hashed(items[i].first, hcs[i], assign, items[i].second);
+    }
+
+    // Batch load vector of pairs
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup = false) {
+        if (dedup) {
+            // naive dedup: sort by key and insert unique
+            std::vector<std::pair<Key,Value>> tmp = items;
+            std::sort(tmp.begin(), tmp.end(), [&](auto &a, auto &b){ return a.first < b.first; });
+            tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+            for (auto &kv : tmp) insert(kv.first, kv.second);
+        } else {
+            for (auto &kv : items) insert(kv.first, kv.second);
+        }
+    }
+
+    // Writes the table to path as a snapshot (see SnapshotHeader): the slot
+    // arrays are dumped as they are, tombstones included, so open() can probe
+    // the file directly. Trivially copyable keys and values only.
+    void save(const std::string& path) const {
+        static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                      "save() writes raw key/value bytes");
+        if (rehashing()) throw std::logic_error("save() during incremental rehash; call finish_rehash()");
+        SnapshotHeader hdr = SnapshotHeader::make(sizeof(Key), sizeof(Value), capacity_, size_, snapshot_flags());
+        SnapshotWriter w(path);
+        w.write(&hdr, sizeof hdr);
+        w.pad_to(hdr.states_off);
+        for (size_t i = 0; i < capacity_; ++i) {
+            uint8_t st = static_cast<uint8_t>(table_.state(i));
+            w.write(&st, 1);
+        }
+        w.pad_to(hdr.keys_off);
+        for (size_t i = 0; i < capacity_; ++i) w.write(&table_.key(i), sizeof(Key));
+        w.pad_to(hdr.values_off);
+        for (size_t i = 0; i < capacity_; ++i) w.write(&table_.value(i), sizeof(Value));
+        if constexpr (kCachedHash) {
+            w.pad_to(hdr.hashes_off);
+            for (size_t i = 0; i < capacity_; ++i) {
+                size_t h = table_.hash(i);
+                w.write(&h, sizeof h);
+            }
+        }
+        w.finish();
+    }
+
+    // Maps a file written by save() read-only; lookups are served from it
+    // without loading or rebuilding anything.
+    static mapped_view open(const std::string& path) { return mapped_view(path); }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    HashPolicy policy_;
+    KeyEqual eq_;
+    CapacityPolicy cap_;
+    size_t capacity_;
+    Allocator alloc_;
+    storage_type table_;
+    size_t size_;
+    size_t deleted_count_;
+    double max_load_;
+    double shrink_load_ = 0;
+
+    // incremental rehash state: next_capacity_ != 0 while the new table is
+    // being set up, then old_capacity_ != 0 while the old one drains; the
+    // migrate_left_ old slots from migrate_from_ on (cyclically) are not
+    // migrated yet
+    storage_type old_table_;
+    CapacityPolicy old_cap_;
+    size_t old_capacity_ = 0;
+    size_t migrate_from_ = 0;
+    size_t migrate_left_ = 0;
+    size_t old_longest_ = 0;
+    storage_type next_table_;
+    size_t next_capacity_ = 0;
+    size_t init_step_ = 0;
+    size_t scan_pos_ = 0;
+    size_t scan_step_ = 0;
+    size_t scan_empty_ = 0; // last empty slot the scan passed
+    size_t longest_ = 0; // longest probe in table_, measured while preparing
+    size_t drain_step_ = 0;
+    size_t migrate_step_ = 0;
+
+    OpStats op_stats_;
+
+    static constexpr bool kCachedHash = Layout::caches_hash;
+    static constexpr size_t kBatch = 32; // keys in flight per find_batch/insert_batch round
+    static constexpr size_t kBulkRegion = 4096; // min slots per bulk_build region
+
+    static uint32_t snapshot_flags() noexcept {
+        return (CapacityPolicy::power_of_two ? SnapshotHeader::kPowerOfTwo : 0) |
+               (kCachedHash ? SnapshotHeader::kCachedHash : 0);
+    }
+
+    using hashing = SlotHashing<Layout, CapacityPolicy, HashPolicy>;
+    template <typename K>
+    size_t hash_of(const K& k) const { return hashing::hash_of(policy_, k, cap_); }
+    size_t home_of(size_t h) const { return hashing::home_of(h, cap_, capacity_); }
+    size_t moved_hash(const storage_type& t, size_t idx) const {
+        return hashing::moved_hash(policy_, t, idx, cap_);
+    }
+
+    template <typename K>
+    size_t locate_in(const storage_type& table, const CapacityPolicy& cap, size_t capacity, const K& k) const {
+        return locate_in(table, cap, capacity, k, hashing::hash_of(policy_, k, cap));
+    }
+    template <typename K>
+    size_t locate_in(const storage_type& table, const CapacityPolicy& cap, size_t capacity, const K& k,
+                     size_t hc) const {
+        size_t h = hashing::home_of(hc, cap, capacity);
+        OpStats::Probe probes(op_stats_);
+        for (size_t i = 0; i < capacity; ++i) {
+            probes.step();
+            size_t idx = cap.wrap(h + i);
+            SlotState st = table.state(idx);
+            if (st == SlotState::Empty) return npos;
+            if (st == SlotState::Occupied && hashing::hash_matches(table, idx, hc) && eq_(table.key(idx), k))
+                return idx;
+            // if deleted or occupied with different key, continue
+        }
+        return npos;
+    }
+
+    template <typename K>
+    size_t locate(const K& k) const { return locate_in(table_, cap_, capacity_, k); }
+
+    // Offset of old slot i from migrate_from_, cyclically.
+    size_t old_offset(size_t i) const noexcept {
+        return i >= migrate_from_ ? i - migrate_from_ : i + old_capacity_ - migrate_from_;
+    }
+    bool unmigrated(size_t i) const noexcept { return old_offset(i) < migrate_left_; }
+
+    // locate_in for the old table mid-migration. Migration starts at an empty
+    // slot, which no probe sequence crosses, and works backwards from there,
+    // so a key still waiting sits on the unmigrated side of its home and
+    // neither its home nor its probe path are ever in the migrated part.
+    // Probes also stop after the old table's longest probe: new keys often
+    // land in its clusters, which only ever shrink from here on.
+    template <typename K>
+    size_t locate_old(const K& k) const {
+        size_t hc = hashing::hash_of(policy_, k, old_cap_);
+        size_t idx = hashing::home_of(hc, old_cap_, old_capacity_);
+        size_t d = old_offset(idx), end = std::min(migrate_left_, d + old_longest_ + 1);
+        OpStats::Probe probes(op_stats_);
+        for (; d < end; ++d, idx = old_cap_.wrap(idx + 1)) {
+            probes.step();
+            SlotState st = old_table_.state(idx);
+            if (st == SlotState::Empty) return npos;
+            if (st == SlotState::Occupied && hashing::hash_matches(old_table_, idx, hc) && eq_(old_table_.key(idx), k))
+                return idx;
+        }
+        return npos;
+    }
+
+    template <typename F>
+    void find_batch_impl(const Key* keys, size_t n, F&& emit) const {
+        size_t hcs[kBatch];
+        for (size_t base = 0; base < n; base += kBatch) {
+            size_t m = std::min(kBatch, n - base);
+            for (size_t j = 0; j < m; ++j) {
+                hcs[j] = hash_of(keys[base + j]);
+                table_.prefetch(home_of(hcs[j]));
+            }
+            for (size_t j = 0; j < m; ++j) {
+                size_t idx = locate_in(table_, cap_, capacity_, keys[base + j], hcs[j]);
+                if (idx != npos) {
+                    emit(base + j, &table_.value(idx));
+                } else if (old_capacity_ && (idx = locate_old(keys[base + j])) != npos) {
+                    emit(base + j, &old_table_.value(idx));
+                } else {
+                    emit(base + j, nullptr);
+                }
+            }
+        }
+    }
+
+    template <typename K>
+    const Value* lookup(const K& k) const {
+        size_t idx = locate(k);
+        if (idx != npos) return &table_.value(idx);
+        if (old_capacity_ && (idx = locate_old(k)) != npos) return &old_table_.value(idx);
+        return nullptr;
+    }
+
+    // Slot holding k, or else the slot k belongs in (first tombstone or empty
+    // slot on its probe path); npos if the whole sequence is occupied.
+    size_t find_slot(const Key& k, size_t hc) const {
+        size_t h = home_of(hc);
+        size_t target = npos;
+        OpStats::Probe probes(op_stats_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            probes.step();
+            size_t idx = cap_.wrap(h + i);
+            SlotState st = table_.state(idx);
+            if (st == SlotState::Empty) return target == npos ? idx : target;
+            if (st == SlotState::Deleted) {
+                // remember tombstone, but keep looking: k may sit further along
+                if (target == npos) target = idx;
+            } else if (hashing::hash_matches(table_, idx, hc) && eq_(table_.key(idx), k)) {
+                return idx;
+            }
+        }
+        return target;
+    }
+
+    // First empty slot on k's probe path (rehash/migration only: k is absent)
+    size_t empty_slot(size_t hc) const {
+        size_t h = home_of(hc);
+        for (size_t i = 0;; ++i) {
+            size_t idx = cap_.wrap(h + i);
+            if (table_.state(idx) == SlotState::Empty) return idx;
+        }
+    }
+
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        if (rehashing()) rehash_step();
+        // while the next table is set up the current one runs past max_load_
+        if (!next_capacity_ && (size_ + deleted_count_ + 1) > static_cast<size_t>(capacity_ * max_load_))
+            grow();
+        if (old_capacity_) {
+            // k may still be waiting in the old table
+            size_t old_idx = locate_old(k);
+            if (old_idx != npos) {
+                if (assign) assign_from(old_table_.value(old_idx), std::forward<Args>(args)...);
+                return false;
+            }
+        }
+
+        return emplace_hashed(std::forward<K>(k), hash_of(k), assign, std::forward<Args>(args)...);
+    }
+
+    // Insert path once the table has room; hc = hash_of(k)
+    template <typename K, typename... Args>
+    bool emplace_hashed(K&& k, size_t hc, bool assign, Args&&... args) {
+        size_t idx = find_slot(k, hc);
+        if (idx == npos) {
+            // table full (shouldn't happen thanks to resize)
+            rehash(capacity_ * 2 + 1);
+            return emplace_impl(std::forward<K>(k), assign, std::forward<Args>(args)...);
+        }
+        if (table_.state(idx) == SlotState::Occupied) {
+            // update
+            if (assign) assign_from(table_.value(idx), std::forward<Args>(args)...);
+            return false;
+        }
+        if (table_.state(idx) == SlotState::Deleted) --deleted_count_; // reuse tombstone
+        table_.key(idx) = std::forward<K>(k);
+        assign_from(table_.value(idx), std::forward<Args>(args)...);
+        table_.set_state(idx, SlotState::Occupied);
+        hashing::store_hash(table_, idx, hc);
+        ++size_;
+        if (next_capacity_) note_probe(idx, hc);
+        return true;
+    }
+
+    // Mostly tombstones: clean up at the same size instead of doubling.
+    void grow() {
+        if (deleted_count_ <= size_) resize(capacity_ * 2);
+        else if (migrate_step_) resize(capacity_);
+        else purge_tombstones();
+    }
+
+    // After an erase: shrink below shrink_load_, or purge once tombstones
+    // fill a quarter of the table and outnumber the elements. A migration in
+    // progress is rebuilding the table anyway.
+    void after_erase() {
+        if (rehashing()) return;
+        if (size_ < capacity_ * shrink_load_) {
+            size_t want = cap_.round_up(shrink_capacity(size_, max_load_));
+            if (want < capacity_) {
+                resize(want);
+                return;
+            }
+        }
+        if (deleted_count_ > capacity_ / 4 && deleted_count_ > size_) {
+            if (migrate_step_) resize(capacity_);
+            else purge_tombstones();
+        }
+    }
+
+    // Stop-the-world rehash, or in incremental mode just the allocation of
+    // the new table; its setup and the migration are spread over the
+    // following operations. The setup finishes before the current table is
+    // (1 + max_load_) / 2 full, and with at least half the new table's
+    // headroom left for the migration (a shrink may have little).
+    void resize(size_t new_cap) {
+        if (migrate_step_ == 0) {
+            rehash(new_cap);
+            return;
+        }
+        finish_rehash(); // one rebuild at a time
+        OpStats::Rehash timer(op_stats_);
+        next_capacity_ = cap_.round_up(new_cap);
+        next_table_.reserve(next_capacity_);
+        scan_pos_ = scan_empty_ = longest_ = 0;
+        size_t used = size_ + deleted_count_;
+        size_t limit = static_cast<size_t>(capacity_ * (1 + max_load_) / 2);
+        size_t next_limit = static_cast<size_t>(next_capacity_ * max_load_);
+        size_t room = std::min(limit > used ? limit - used : 0, next_limit > size_ ? (next_limit - size_) / 2 : 0);
+        room = std::max<size_t>(room, 1);
+        init_step_ = std::max(migrate_step_, (next_capacity_ + room - 1) / room);
+        scan_step_ = std::max(migrate_step_, (capacity_ + room - 1) / room);
+    }
+
+    // The bounded share of a pending rehash done by each insert/erase.
+    void rehash_step() {
+        if (next_capacity_) prepare(init_step_, scan_step_);
+        else migrate(drain_step_);
+    }
+
+    // Sets up the next init slots of the next table and measures the probe
+    // lengths of the next scan slots of the current one (inserts meanwhile
+    // report theirs); starts the migration once both are done.
+    void prepare(size_t init, size_t scan) {
+        next_table_.extend(std::min(init, next_capacity_ - next_table_.capacity()));
+        for (size_t end = std::min(capacity_, scan_pos_ + scan); scan_pos_ < end; ++scan_pos_) {
+            SlotState st = table_.state(scan_pos_);
+            if (st == SlotState::Occupied) note_probe(scan_pos_, moved_hash(table_, scan_pos_));
+            else if (st == SlotState::Empty) scan_empty_ = scan_pos_;
+        }
+        if (next_table_.capacity() == next_capacity_ && scan_pos_ == capacity_) start_migration();
+    }
+    void note_probe(size_t idx, size_t hc) {
+        size_t h = home_of(hc);
+        longest_ = std::max(longest_, idx >= h ? idx - h : idx + capacity_ - h);
+    }
+
+    // Swaps in the fully set up next table. The old one must drain before
+    // the new one reaches max_load_, hence at least old_capacity_ / headroom
+    // slots per operation.
+    void start_migration() {
+        // an empty slot to start from: the one the scan saw, or the next one
+        // down if an insert has taken it since
+        migrate_from_ = scan_empty_;
+        for (size_t n = 0; n < capacity_ && table_.state(migrate_from_) != SlotState::Empty; ++n)
+            migrate_from_ = migrate_from_ ? migrate_from_ - 1 : capacity_ - 1;
+        old_table_ = std::move(table_);
+        old_cap_ = cap_;
+        old_capacity_ = migrate_left_ = capacity_;
+        old_longest_ = longest_;
+        table_ = std::move(next_table_);
+        next_table_ = storage_type(alloc_);
+        capacity_ = next_capacity_;
+        next_capacity_ = 0;
+        cap_.reset(capacity_);
+        deleted_count_ = 0;
+        size_t limit = static_cast<size_t>(capacity_ * max_load_);
+        size_t headroom = limit > size_ ? limit - size_ : 1;
+        drain_step_ = std::max(migrate_step_, (old_capacity_ + headroom - 1) / headroom);
+    }
+
+    // Moves the next n old slots, walking backwards from migrate_from_, into
+    // the current table.
+    void migrate(size_t n) {
+        for (; n && migrate_left_; --n) {
+            size_t i = old_cap_.wrap(migrate_from_ + --migrate_left_);
+            if (old_table_.state(i) != SlotState::Occupied) continue;
+            size_t hc = moved_hash(old_table_, i);
+            size_t idx = empty_slot(hc);
+            table_.key(idx) = std::move(old_table_.key(i));
+            table_.value(idx) = std::move(old_table_.value(i));
+            table_.set_state(idx, SlotState::Occupied);
+            hashing::store_hash(table_, idx, hc);
+        }
+        if (old_capacity_ && migrate_left_ == 0) {
+            old_table_ = storage_type(alloc_);
+            old_capacity_ = 0;
+        }
+    }
+
+    // Keys in the old table are unique and the new table has no tombstones, so
+    // every element is moved straight into the first empty slot of its probe
+    // sequence: no key comparisons, no per-element load checks.
+    void rehash(size_t new_cap) {
+        finish_rehash();
+        OpStats::Rehash timer(op_stats_);
+        new_cap = cap_.round_up(new_cap);
+        storage_type old = std::move(table_);
+        table_.assign(new_cap);
+        size_t old_capacity = capacity_;
+        capacity_ = new_cap;
+        cap_.reset(capacity_);
+        deleted_count_ = 0;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old.state(i) != SlotState::Occupied) continue;
+            size_t hc = moved_hash(old, i);
+            size_t idx = empty_slot(hc);
+            table_.key(idx) = std::move(old.key(i));
+            table_.value(idx) = std::move(old.value(i));
+            table_.set_state(idx, SlotState::Occupied);
+            hashing::store_hash(table_, idx, hc);
+        }
+    }
+};
+
+// Read-only LinearProbingHashMap over a mapped snapshot file; obtained from
+// LinearProbingHashMap<...>::open(path). Probes exactly like the map that
+// wrote it. Returned pointers stay valid for the lifetime of the view.
+template <typename Key, typename Value, typename HashPolicy, typename KeyEqual,
+          typename CapacityPolicy, bool CachedHash>
+class MappedLinearProbingHashMap {
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "snapshots hold raw key/value bytes");
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+
+    explicit MappedLinearProbingHashMap(const std::string& path) : file_(path) {
+        const uint32_t flags = (CapacityPolicy::power_of_two ? SnapshotHeader::kPowerOfTwo : 0) |
+                               (CachedHash ? SnapshotHeader::kCachedHash : 0);
+        if (file_.size() < sizeof(SnapshotHeader)) throw std::runtime_error("not a snapshot: " + path);
+        SnapshotHeader hdr;
+        std::memcpy(&hdr, file_.data(), sizeof hdr);
+        if (!hdr.compatible(SnapshotHeader::make(sizeof(Key), sizeof(Value), 0, 0, flags), file_.size()) ||
+            hdr.capacity == 0 || (CapacityPolicy::power_of_two && (hdr.capacity & (hdr.capacity - 1))))
+            throw std::runtime_error("incompatible snapshot: " + path);
+        capacity_ = static_cast<size_t>(hdr.capacity);
+        size_ = static_cast<size_t>(hdr.size);
+        cap_.reset(capacity_);
+        const unsigned char* base = file_.data();
+        states_ = base + hdr.states_off;
+        keys_ = reinterpret_cast<const Key*>(base + hdr.keys_off);
+        values_ = reinterpret_cast<const Value*>(base + hdr.values_off);
+        if constexpr (CachedHash) hashes_ = reinterpret_cast<const size_t*>(base + hdr.hashes_off);
+    }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+    const Value* find_ptr(const Key& k) const {
+        size_t idx = locate(k);
+        return idx == npos ? nullptr : &values_[idx];
+    }
+    bool contains(const Key& k) const { return locate(k) != npos; }
+
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return capacity_; }
+
+    // Same metrics as LinearProbingHashMap::stats(); the structural part
+    // scans the mapped state array, so it touches every page of it.
+    HashMapStats stats() const {
+        size_t tombstones = 0;
+        for (size_t i = 0; i < capacity_; ++i) tombstones += states_[i] == static_cast<unsigned char>(SlotState::Deleted);
+        HashMapStats s;
+        fill_structure(s, size_, capacity_, tombstones, longest_run(capacity_, [this](size_t i) {
+            return static_cast<SlotState>(states_[i]) != SlotState::Empty;
+        }));
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    MappedFile file_;
+    HashPolicy policy_;
+    KeyEqual eq_;
+    CapacityPolicy cap_;
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    const unsigned char* states_ = nullptr;
+    const Key* keys_ = nullptr;
+    const Value* values_ = nullptr;
+    const size_t* hashes_ = nullptr;
+    OpStats op_stats_;
+
+    // same hash, home slot and probe sequence as LinearProbingHashMap::locate_in
+    size_t locate(const Key& k) const {
+        size_t hc = policy_(k, CachedHash ? kHashRange : cap_.modulus());
+        size_t h;
+        if constexpr (CachedHash && !CapacityPolicy::power_of_two) h = cap_.index(hc % capacity_);
+        else h = cap_.index(hc);
+        OpStats::Probe probes(op_stats_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            probes.step();
+            size_t idx = cap_.wrap(h + i);
+            SlotState st = static_cast<SlotState>(states_[idx]);
+            if (st == SlotState::Empty) return npos;
+            if (st == SlotState::Occupied && (!CachedHash || hashes_[idx] == hc) && eq_(keys_[idx], k)) return idx;
+        }
+        return npos;
+    }
+};
+
+// -----------------------------
+// Quadratic probing map (hi = h + c1*i + c2*i^2)
+// -----------------------------
+template <
+    typename Key,
+    typename Value,
+    typename HashPolicy = DivisionHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename CapacityPolicy = PrimeCapacity,
+    typename Layout = AoSLayout,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class QuadraticProbingHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using capacity_policy = CapacityPolicy;
+    using allocator_type = Allocator;
+    using storage_type = typename Layout::template storage<Key,Value,Allocator>;
+
+    // With a power-of-two CapacityPolicy c1/c2 are ignored and the triangular
+    // sequence h + i(i+1)/2 is used, the quadratic sequence that is guaranteed
+    // to visit every slot of a 2^k table.
+    QuadraticProbingHashMap(size_t initial_capacity = 17, double max_load = 0.5, size_t c1 = 1, size_t c2 = 1,
+                            const Allocator& alloc = Allocator())
+        : policy_(), eq_(), alloc_(alloc), table_(alloc), size_(0), deleted_count_(0), c1_(c1), c2_(c2), max_load_(max_load) {
+        // good practice: odd prime capacity helps quadratic sequences
+        capacity_ = cap_.round_up(initial_capacity);
+        cap_.reset(capacity_);
+        table_.assign(capacity_);
+    }
+
+    bool insert(const Key& k, const Value& v) { return emplace_impl(k, true, v); }
+    bool insert(Key&& k, Value&& v) { return emplace_impl(std::move(k), true, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...); }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    const Value* find_ptr(const Key& k) const { return value_ptr(locate(k)); }
+    Value* find_ptr(const Key& k) { return value_ptr(locate(k)); }
+
+    bool contains(const Key& k) const { return locate(k) != npos; }
+
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    Value* find_ptr(const K& k) { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return locate(k) != npos; }
+
+    bool erase(const Key& k) {
+        size_t idx = locate(k);
+        if (idx == npos) return false;
+        table_.set_state(idx, SlotState::Deleted); --size_; ++deleted_count_;
+        after_erase();
+        return true;
+    }
+
+    size_t size() const noexcept { return size_; }
+    void clear() noexcept { table_.assign(capacity_); size_ = 0; deleted_count_ = 0; }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (table_.state(i) == SlotState::Occupied) f(table_.key(i), table_.value(i));
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (table_.state(i) == SlotState::Occupied) f(std::as_const(table_.key(i)), table_.value(i));
+    }
+
+    // Load, tombstones and primary clustering (longest run of non-empty slots),
+    // plus the HASHING_STATS counters.
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size_, capacity_, deleted_count_,
+                       longest_run(capacity_, [this](size_t i) { return table_.state(i) != SlotState::Empty; }));
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return alloc_; }
+
+    void purge_tombstones() {
+        OpStats::Rehash timer(op_stats_);
+        auto stranded = purge_tombstones_in_place<Key, Value, kCachedHash>(
+            table_, capacity_, [this](size_t i, auto&& is_free) {
+                size_t h = home_of(moved_hash(table_, i));
+                for (size_t n = 0; n < capacity_; ++n)
+                    if (is_free(probe(h, n))) return probe(h, n);
+                return npos;
+            });
+        deleted_count_ = 0;
+        // prime-size quadratic sequences reach only half the slots
+        size_ -= stranded.size();
+        for (auto& kv : stranded) emplace_impl(std::move(kv.first), true, std::move(kv.second));
+    }
+
+    void set_shrink_load(double min_load) {
+        check_shrink_load(min_load, max_load_);
+        shrink_load_ = min_load;
+    }
+
+    void shrink_to_fit() { rehash(static_cast<size_t>(size_ / max_load_) + 1); }
+
+    void reserve(size_t n) {
+        size_t want = cap_.round_up(static_cast<size_t>(n / max_load_) + 1);
+        if (want > capacity_) rehash(want);
+        else if (deleted_count_) purge_tombstones();
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
+        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
+        std::vector<std::pair<Key,Value>> tmp = items;
+        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
+        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+        for (auto &kv : tmp) insert(kv.first, kv.second);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    HashPolicy policy_;
+    KeyEqual eq_;
+    CapacityPolicy cap_;
+    size_t capacity_;
+    Allocator alloc_;
+    storage_type table_;
+    size_t size_;
+    size_t deleted_count_;
+    double shrink_load_ = 0;
+    size_t c1_, c2_;
+    double max_load_;
+    OpStats op_stats_;
+
+    static constexpr bool kCachedHash = Layout::caches_hash;
+
+    using hashing = SlotHashing<Layout, CapacityPolicy, HashPolicy>;
+    template <typename K>
+    size_t hash_of(const K& k) const { return hashing::hash_of(policy_, k, cap_); }
+    size_t home_of(size_t h) const { return hashing::home_of(h, cap_, capacity_); }
+    size_t moved_hash(const storage_type& t, size_t idx) const {
+        return hashing::moved_hash(policy_, t, idx, cap_);
+    }
+
+    template <typename K>
+    size_t locate(const K& k) const {
+        size_t hc = hash_of(k);
+        size_t h = home_of(hc);
+        OpStats::Probe probes(op_stats_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            probes.step();
+            size_t idx = probe(h, i);
+            SlotState st = table_.state(idx);
+            if (st == SlotState::Empty) return npos;
+            if (st == SlotState::Occupied && hashing::hash_matches(table_, idx, hc) && eq_(table_.key(idx), k))
+                return idx;
+        }
+        return npos;
+    }
+
+    const Value* value_ptr(size_t idx) const { return idx == npos ? nullptr : &table_.value(idx); }
+    Value* value_ptr(size_t idx) { return idx == npos ? nullptr : &table_.value(idx); }
+
+    size_t probe(size_t h, size_t i) const noexcept {
+        if constexpr (CapacityPolicy::power_of_two) return cap_.wrap(h + i * (i + 1) / 2);
+        else return cap_.wrap(h + c1_*i + c2_*i*i);
+    }
+
+    // Slot holding k, or else the slot k belongs in (first tombstone or empty
+    // slot on its probe path); npos if the whole sequence is occupied.
+    size_t find_slot(const Key& k, size_t hc) const {
+        size_t h = home_of(hc);
+        size_t target = npos;
+        OpStats::Probe probes(op_stats_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            probes.step();
+            size_t idx = probe(h, i);
+            SlotState st = table_.state(idx);
+            if (st == SlotState::Empty) return target == npos ? idx : target;
+            if (st == SlotState::Deleted) {
+                // remember tombstone, but keep looking: k may sit further along
+                if (target == npos) target = idx;
+            } else if (hashing::hash_matches(table_, idx, hc) && eq_(table_.key(idx), k)) {
+                return idx;
+            }
+        }
+        return target;
+    }
+
+    // First empty slot on k's probe path (rehash only: no tombstones, k absent)
+    size_t empty_slot(size_t hc) const {
+        size_t h = home_of(hc);
+        for (size_t i = 0; i < capacity_; ++i) {
+            size_t idx = probe(h, i);
+            if (table_.state(idx) == SlotState::Empty) return idx;
+        }
+        return npos;
+    }
+
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        if ((size_ + deleted_count_ + 1) > static_cast<size_t>(capacity_ * max_load_)) {
+            // mostly tombstones -> clean up at the same size, otherwise grow
+            if (deleted_count_ > size_) purge_tombstones();
+            else rehash(capacity_ * 2);
+        }
+
+        size_t hc = hash_of(k);
+        size_t idx = find_slot(k, hc);
+        if (idx == npos) {
+            // table full (shouldn't happen thanks to resize)
+            rehash(capacity_ * 2 + 1);
+            return emplace_impl(std::forward<K>(k), assign, std::forward<Args>(args)...);
+        }
+        if (table_.state(idx) == SlotState::Occupied) {
+            // update
+            if (assign) assign_from(table_.value(idx), std::forward<Args>(args)...);
+            return false;
+        }
+        if (table_.state(idx) == SlotState::Deleted) --deleted_count_; // reuse tombstone
+        table_.key(idx) = std::forward<K>(k);
+        assign_from(table_.value(idx), std::forward<Args>(args)...);
+        table_.set_state(idx, SlotState::Occupied);
+        hashing::store_hash(table_, idx, hc);
+        ++size_;
+        return true;
+    }
+
+    // After an erase: shrink below shrink_load_, or purge once tombstones
+    // fill a quarter of the table and outnumber the elements.
+    void after_erase() {
+        if (size_ < capacity_ * shrink_load_) {
+            size_t want = cap_.round_up(shrink_capacity(size_, max_load_));
+            if (want < capacity_) {
+                rehash(want);
+                return;
+            }
+        }
+        if (deleted_count_ > capacity_ / 4 && deleted_count_ > size_) purge_tombstones();
+    }
+
+    // Keys in the old table are unique and the new table has no tombstones, so
+    // every element is moved straight into the first empty slot of its probe
+    // sequence: no key comparisons, no per-element load checks.
+    void rehash(size_t new_cap) {
+        OpStats::Rehash timer(op_stats_);
+        new_cap = cap_.round_up(new_cap);
+        storage_type old = std::move(table_);
+        table_.assign(new_cap);
+        size_t old_capacity = capacity_;
+        capacity_ = new_cap;
+        cap_.reset(capacity_);
+        deleted_count_ = 0;
+        std::vector<size_t> stranded; // prime-size quadratic sequences reach only half the slots
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old.state(i) != SlotState::Occupied) continue;
+            size_t hc = moved_hash(old, i);
+            size_t idx = empty_slot(hc);
+            if (idx == npos) { stranded.push_back(i); continue; }
+            table_.key(idx) = std::move(old.key(i));
+            table_.value(idx) = std::move(old.value(i));
+            table_.set_state(idx, SlotState::Occupied);
+            hashing::store_hash(table_, idx, hc);
+        }
+        size_ -= stranded.size();
+        for (size_t i : stranded) emplace_impl(std::move(old.key(i)), true, std::move(old.value(i)));
+    }
+};
+
+// -----------------------------
+// Double Hashing map: hi = (h1 + i * h2) mod M
+// -----------------------------
+template <
+    typename Key,
+    typename Value,
+    typename HashPolicy1 = DivisionHash<Key>,
+    typename HashPolicy2 = DivisionHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename CapacityPolicy = PrimeCapacity,
+    typename Layout = AoSLayout,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class DoubleHashingHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using capacity_policy = CapacityPolicy;
+    using allocator_type = Allocator;
+    using storage_type = typename Layout::template storage<Key,Value,Allocator>;
+
+    DoubleHashingHashMap(size_t initial_capacity = 17, double max_load = 0.6, const Allocator& alloc = Allocator())
+        : hp1_(), hp2_(), eq_(), alloc_(alloc), table_(alloc), size_(0), deleted_count_(0), max_load_(max_load) {
+        capacity_ = cap_.round_up(initial_capacity);
+        cap_.reset(capacity_);
+        table_.assign(capacity_);
+    }
+
+    bool insert(const Key& k, const Value& v) { return emplace_impl(k, true, v); }
+    bool insert(Key&& k, Value&& v) { return emplace_impl(std::move(k), true, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...); }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    const Value* find_ptr(const Key& k) const { return value_ptr(locate(k)); }
+    Value* find_ptr(const Key& k) { return value_ptr(locate(k)); }
+
+    bool contains(const Key& k) const { return locate(k) != npos; }
+
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    Value* find_ptr(const K& k) { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return locate(k) != npos; }
+
+    bool erase(const Key& k) {
+        size_t idx = locate(k);
+        if (idx == npos) return false;
+        table_.set_state(idx, SlotState::Deleted); --size_; ++deleted_count_;
+        after_erase();
+        return true;
+    }
+
+    size_t size() const noexcept { return size_; }
+    void clear() noexcept { table_.assign(capacity_); size_ = 0; deleted_count_ = 0; }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (table_.state(i) == SlotState::Occupied) f(table_.key(i), table_.value(i));
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (table_.state(i) == SlotState::Occupied) f(std::as_const(table_.key(i)), table_.value(i));
+    }
+
+    // Load, tombstones and primary clustering (longest run of non-empty slots),
+    // plus the HASHING_STATS counters.
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size_, capacity_, deleted_count_,
+                       longest_run(capacity_, [this](size_t i) { return table_.state(i) != SlotState::Empty; }));
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return alloc_; }
+
+    void purge_tombstones() {
+        OpStats::Rehash timer(op_stats_);
+        purge_tombstones_in_place<Key, Value, kCachedHash>(table_, capacity_, [this](size_t i, auto&& is_free) {
+            size_t h1 = home_of(moved_hash(table_, i));
+            size_t h2 = step(table_.key(i));
+            for (size_t n = 0;; ++n)
+                if (is_free(cap_.wrap(h1 + n * h2))) return cap_.wrap(h1 + n * h2);
+        });
+        deleted_count_ = 0;
+    }
+
+    void set_shrink_load(double min_load) {
+        check_shrink_load(min_load, max_load_);
+        shrink_load_ = min_load;
+    }
+
+    void shrink_to_fit() { rehash(static_cast<size_t>(size_ / max_load_) + 1); }
+
+    void reserve(size_t n) {
+        size_t want = cap_.round_up(static_cast<size_t>(n / max_load_) + 1);
+        if (want > capacity_) rehash(want);
+        else if (deleted_count_) purge_tombstones();
+    }
+
+    // Batched lookup: out[i] = find_ptr(keys[i]). Keys are hashed and their
+    // home slots prefetched kBatch at a time before any of them is resolved,
+    // so the cache misses of a batch overlap instead of queueing up.
+    void find_batch(const Key* keys, size_t n, const Value** out) const {
+        find_batch_impl(keys, n, [out](size_t i, const Value* v) { out[i] = v; });
+    }
+    void find_batch(const Key* keys, size_t n, Value** out) {
+        find_batch_impl(keys, n, [out](size_t i, const Value* v) { out[i] = const_cast<Value*>(v); });
+    }
+
+    // Batched insert-or-assign of keys[i] -> values[i]; returns how many keys
+    // were new. Grows once per chunk, then hashes and prefetches it like
+    // find_batch.
+    size_t insert_batch(const Key* keys, const Value* values, size_t n) {
+        size_t added = 0;
+        size_t hcs[kBatch];
+        for (size_t base = 0; base < n; base += kBatch) {
+            size_t m = std::min(kBatch, n - base);
+            while ((size_ + deleted_count_ + m) > static_cast<size_t>(capacity_ * max_load_)) {
+                if (deleted_count_ > size_) purge_tombstones();
+                else rehash(capacity_ * 2);
+            }
+            for (size_t j = 0; j < m; ++j) {
+                hcs[j] = hash_of(keys[base + j]);
+                table_.prefetch(home_of(hcs[j]));
+            }
+            for (size_t j = 0; j < m; ++j)
+                added += emplace_hashed(keys[base + j], hcs[j], true, values[base + j]);
+        }
+        return added;
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
+        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
+        std::vector<std::pair<Key,Value>> tmp = items;
+        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
+        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+        for (auto &kv : tmp) insert(kv.first, kv.second);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    HashPolicy1 hp1_;
     HashPolicy2 hp2_;
     KeyEqual eq_;
-    size_t capacity_;
-    std::vector<Slot<Key,Value>> table_;
-    size_t size_;
-    size_t deleted_count_;
-    double max_load_;
+    CapacityPolicy cap_;
+    size_t capacity_;
+    Allocator alloc_;
+    storage_type table_;
+    size_t size_;
+    size_t deleted_count_;
+    double shrink_load_ = 0;
+    double max_load_;
+    OpStats op_stats_;
+
+    static constexpr bool kCachedHash = Layout::caches_hash;
+    static constexpr size_t kBatch = 32; // keys in flight per find_batch/insert_batch round
+
+    using hashing = SlotHashing<Layout, CapacityPolicy, HashPolicy1>;
+    template <typename K>
+    size_t hash_of(const K& k) const { return hashing::hash_of(hp1_, k, cap_); }
+    size_t home_of(size_t h) const { return hashing::home_of(h, cap_, capacity_); }
+    size_t moved_hash(const storage_type& t, size_t idx) const {
+        return hashing::moved_hash(hp1_, t, idx, cap_);
+    }
+    // second hash is reduced by the real capacity so the step stays in [1, capacity)
+    template <typename K>
+    size_t step(const K& k) const { return cap_.step(hp2_.second(k, capacity_)); }
+
+    template <typename K>
+    size_t locate(const K& k) const { return locate(k, hash_of(k)); }
+    template <typename K>
+    size_t locate(const K& k, size_t hc) const {
+        size_t h1 = home_of(hc);
+        size_t h2 = step(k);
+        OpStats::Probe probes(op_stats_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            probes.step();
+            size_t idx = cap_.wrap(h1 + i * h2);
+            SlotState st = table_.state(idx);
+            if (st == SlotState::Empty) return npos;
+            if (st == SlotState::Occupied && hashing::hash_matches(table_, idx, hc) && eq_(table_.key(idx), k))
+                return idx;
+        }
+        return npos;
+    }
+
+    template <typename F>
+    void find_batch_impl(const Key* keys, size_t n, F&& emit) const {
+        size_t hcs[kBatch];
+        for (size_t base = 0; base < n; base += kBatch) {
+            size_t m = std::min(kBatch, n - base);
+            for (size_t j = 0; j < m; ++j) {
+                hcs[j] = hash_of(keys[base + j]);
+                table_.prefetch(home_of(hcs[j]));
+            }
+            for (size_t j = 0; j < m; ++j)
+                emit(base + j, value_ptr(locate(keys[base + j], hcs[j])));
+        }
+    }
+
+    const Value* value_ptr(size_t idx) const { return idx == npos ? nullptr : &table_.value(idx); }
+    Value* value_ptr(size_t idx) { return idx == npos ? nullptr : &table_.value(idx); }
+
+    // Slot holding k, or else the slot k belongs in (first tombstone or empty
+    // slot on its probe path); npos if the whole sequence is occupied.
+    size_t find_slot(const Key& k, size_t hc) const {
+        size_t h1 = home_of(hc);
+        size_t h2 = step(k);
+        size_t target = npos;
+        OpStats::Probe probes(op_stats_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            probes.step();
+            size_t idx = cap_.wrap(h1 + i * h2);
+            SlotState st = table_.state(idx);
+            if (st == SlotState::Empty) return target == npos ? idx : target;
+            if (st == SlotState::Deleted) {
+                // remember tombstone, but keep looking: k may sit further along
+                if (target == npos) target = idx;
+            } else if (hashing::hash_matches(table_, idx, hc) && eq_(table_.key(idx), k)) {
+                return idx;
+            }
+        }
+        return target;
+    }
+
+    // First empty slot on k's probe path (rehash only: no tombstones, k absent);
+    // hc is k's hash
+    size_t empty_slot(const Key& k, size_t hc) const {
+        size_t h1 = home_of(hc);
+        size_t h2 = step(k);
+        for (size_t i = 0;; ++i) {
+            size_t idx = cap_.wrap(h1 + i * h2);
+            if (table_.state(idx) == SlotState::Empty) return idx;
+        }
+    }
+
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        if ((size_ + deleted_count_ + 1) > static_cast<size_t>(capacity_ * max_load_)) {
+            // mostly tombstones -> clean up at the same size, otherwise grow
+            if (deleted_count_ > size_) purge_tombstones();
+            else rehash(capacity_ * 2);
+        }
+
+        return emplace_hashed(std::forward<K>(k), hash_of(k), assign, std::forward<Args>(args)...);
+    }
+
+    // Insert path once the table has room; hc = hash_of(k)
+    template <typename K, typename... Args>
+    bool emplace_hashed(K&& k, size_t hc, bool assign, Args&&... args) {
+        size_t idx = find_slot(k, hc);
+        if (idx == npos) {
+            // table full (shouldn't happen thanks to resize)
+            rehash(capacity_ * 2 + 1);
+            return emplace_impl(std::forward<K>(k), assign, std::forward<Args>(args)...);
+        }
+        if (table_.state(idx) == SlotState::Occupied) {
+            // update
+            if (assign) assign_from(table_.value(idx), std::forward<Args>(args)...);
+            return false;
+        }
+        if (table_.state(idx) == SlotState::Deleted) --deleted_count_; // reuse tombstone
+        table_.key(idx) = std::forward<K>(k);
+        assign_from(table_.value(idx), std::forward<Args>(args)...);
+        table_.set_state(idx, SlotState::Occupied);
+        hashing::store_hash(table_, idx, hc);
+        ++size_;
+        return true;
+    }
+
+    // After an erase: shrink below shrink_load_, or purge once tombstones
+    // fill a quarter of the table and outnumber the elements.
+    void after_erase() {
+        if (size_ < capacity_ * shrink_load_) {
+            size_t want = cap_.round_up(shrink_capacity(size_, max_load_));
+            if (want < capacity_) {
+                rehash(want);
+                return;
+            }
+        }
+        if (deleted_count_ > capacity_ / 4 && deleted_count_ > size_) purge_tombstones();
+    }
+
+    // Keys in the old table are unique and the new table has no tombstones, so
+    // every element is moved straight into the first empty slot of its probe
+    // sequence: no key comparisons, no per-element load checks.
+    void rehash(size_t new_cap) {
+        OpStats::Rehash timer(op_stats_);
+        new_cap = cap_.round_up(new_cap);
+        storage_type old = std::move(table_);
+        table_.assign(new_cap);
+        size_t old_capacity = capacity_;
+        capacity_ = new_cap;
+        cap_.reset(capacity_);
+        deleted_count_ = 0;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old.state(i) != SlotState::Occupied) continue;
+            size_t hc = moved_hash(old, i);
+            size_t idx = empty_slot(old.key(i), hc);
+            table_.key(idx) = std::move(old.key(i));
+            table_.value(idx) = std::move(old.value(i));
+            table_.set_state(idx, SlotState::Occupied);
+            hashing::store_hash(table_, idx, hc);
+        }
+    }
+};
+
+// -----------------------------
+// Cuckoo hashing (two tables / two hash functions).
+// canonical simple implementation with relocation limit and rehash.
+// -----------------------------
+template <
+    typename Key,
+    typename Value,
+    typename Hash1 = DivisionHash<Key>,
+    typename Hash2 = MidSquareHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class CuckooHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using allocator_type = Allocator;
+
+    CuckooHashMap(size_t initial_capacity = 16, double max_load = 0.5, size_t max_kicks = 500,
+                  const Allocator& alloc = Allocator())
+        : h1_(), h2_(), eq_(), table1_(alloc), table2_(alloc), max_load_(max_load), max_kicks_(max_kicks) {
+        capacity_ = next_prime(std::max<size_t>(initial_capacity, 3));
+        table1_.assign(capacity_, std::optional<std::pair<Key,Value>>());
+        table2_.assign(capacity_, std::optional<std::pair<Key,Value>>());
+        size_ = 0;
+    }
+
+    // insert keeps its original semantics: an existing key is left unchanged
+    bool insert(const Key& k, const Value& v) { return emplace_impl(k, false, v); }
+    bool insert(Key&& k, Value&& v) { return emplace_impl(std::move(k), false, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...); }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    const Value* find_ptr(const Key& k) const { return value_ptr(locate(k)); }
+    Value* find_ptr(const Key& k) { return const_cast<Value*>(value_ptr(locate(k))); }
+
+    bool contains(const Key& k) const { return locate(k) != nullptr; }
+
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    Value* find_ptr(const K& k) { return const_cast<Value*>(value_ptr(locate(k))); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return locate(k) != nullptr; }
+
+    bool erase(const Key& k) {
+        OpStats::Probe probes(op_stats_);
+        probes.step();
+        size_t i1 = h1_(k, capacity_);
+        if (table1_[i1] && eq_(table1_[i1]->first, k)) { table1_[i1].reset(); --size_; return true; }
+        probes.step();
+        size_t i2 = h2_(k, capacity_);
+        if (table2_[i2] && eq_(table2_[i2]->first, k)) { table2_[i2].reset(); --size_; return true; }
+        return false;
+    }
+
+    size_t size() const noexcept { return size_; }
+    void clear() {
+        table1_.assign(capacity_, std::nullopt);
+        table2_.assign(capacity_, std::nullopt);
+        size_ = 0;
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const auto* t : {&table1_, &table2_})
+            for (const auto& e : *t)
+                if (e) f(e->first, e->second);
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        for (auto* t : {&table1_, &table2_})
+            for (auto& e : *t)
+                if (e) f(std::as_const(e->first), e->second);
+    }
+
+    // Load over all slots of both tables (no tombstones, no probe chains; a
+    // lookup checks one or two slots), plus the HASHING_STATS counters.
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size_, 2 * capacity_, 0, 0);
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return allocator_type(table1_.get_allocator()); }
+
+    // Both tables together; larger if an element finds no place in them.
+    void shrink_to_fit() { rehash(static_cast<size_t>(size_ / (2 * max_load_)) + 1); }
+
+    void reserve(size_t n) {
+        size_t want = next_prime(static_cast<size_t>(n / (2 * max_load_)) + 1);
+        if (want > capacity_) rehash(want);
+    }
+
+    // Batched lookup: out[i] = find_ptr(keys[i]). Keys are hashed and their
+    // home slots prefetched kBatch at a time before any of them is resolved,
+    // so the cache misses of a batch overlap instead of queueing up.
+    void find_batch(const Key* keys, size_t n, const Value** out) const {
+        find_batch_impl(keys, n, [out](size_t i, const Value* v) { out[i] = v; });
+    }
+    void find_batch(const Key* keys, size_t n, Value** out) {
+        find_batch_impl(keys, n, [out](size_t i, const Value* v) { out[i] = const_cast<Value*>(v); });
+    }
+
+    // Batched insert (same semantics as insert()); returns how many keys were
+    // new. Grows once per chunk and prefetches both candidate slots of every
+    // key before inserting them.
+    size_t insert_batch(const Key* keys, const Value* values, size_t n) {
+        size_t added = 0;
+        for (size_t base = 0; base < n; base += kBatch) {
+            size_t m = std::min(kBatch, n - base);
+            while ((size_ + m) > static_cast<size_t>(2 * capacity_ * max_load_))
+                rehash(next_prime(capacity_ * 2));
+            for (size_t j = 0; j < m; ++j) {
+                prefetch(&table1_[h1_(keys[base + j], capacity_)]);
+                prefetch(&table2_[h2_(keys[base + j], capacity_)]);
+            }
+            for (size_t j = 0; j < m; ++j) added += insert(keys[base + j], values[base + j]);
+        }
+        return added;
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
+        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
+        std::vector<std::pair<Key,Value>> tmp = items;
+        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
+        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+        for (auto &kv : tmp) insert(kv.first, kv.second);
+    }
+
+private:
+    Hash1 h1_;
+    Hash2 h2_;
+    KeyEqual eq_;
+    size_t capacity_;
+    alloc_vector<std::optional<std::pair<Key,Value>>, Allocator> table1_;
+    alloc_vector<std::optional<std::pair<Key,Value>>, Allocator> table2_;
+    size_t size_;
+    double max_load_;
+    size_t max_kicks_;
+    OpStats op_stats_;
+
+    static constexpr size_t kBatch = 32; // keys in flight per find_batch/insert_batch round
+
+    template <typename K>
+    const std::pair<Key,Value>* locate(const K& k) const {
+        return locate(k, h1_(k, capacity_), h2_(k, capacity_));
+    }
+    template <typename K>
+    const std::pair<Key,Value>* locate(const K& k, size_t i1, size_t i2) const {
+        OpStats::Probe probes(op_stats_);
+        probes.step();
+        if (table1_[i1] && eq_(table1_[i1]->first, k)) return &*table1_[i1];
+        probes.step();
+        if (table2_[i2] && eq_(table2_[i2]->first, k)) return &*table2_[i2];
+        return nullptr;
+    }
+
+    template <typename F>
+    void find_batch_impl(const Key* keys, size_t n, F&& emit) const {
+        size_t i1[kBatch], i2[kBatch];
+        for (size_t base = 0; base < n; base += kBatch) {
+            size_t m = std::min(kBatch, n - base);
+            for (size_t j = 0; j < m; ++j) {
+                i1[j] = h1_(keys[base + j], capacity_);
+                i2[j] = h2_(keys[base + j], capacity_);
+                prefetch(&table1_[i1[j]]);
+                prefetch(&table2_[i2[j]]);
+            }
+            for (size_t j = 0; j < m; ++j)
+                emit(base + j, value_ptr(locate(keys[base + j], i1[j], i2[j])));
+        }
+    }
+
+    static const Value* value_ptr(const std::pair<Key,Value>* kv) { return kv ? &kv->second : nullptr; }
+
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        if ((size_ + 1) > static_cast<size_t>(2 * capacity_ * max_load_)) {
+            rehash(next_prime(capacity_ * 2));
+        }
+        if (auto* kv = locate(k)) { // no duplicates
+            if (assign) assign_from(const_cast<Value&>(kv->second), std::forward<Args>(args)...);
+            return false;
+        }
+        std::pair<Key,Value> cur(std::forward<K>(k), Value(std::forward<Args>(args)...));
+        // too many kicks -> rehash to larger size and retry with whoever is left homeless
+        while (!place(cur)) rehash(next_prime(capacity_ * 2));
+        ++size_;
+        return true;
+    }
+
+    // Cuckoo insertion of an element known to be absent. On failure after
+    // max_kicks_ evictions, cur holds the element that is left without a slot.
+    bool place(std::pair<Key,Value>& cur) {
+        size_t table_id = 1;
+        for (size_t kick = 0; kick < max_kicks_; ++kick) {
+            if (table_id == 1) {
+                size_t idx = h1_(cur.first, capacity_);
+                if (!table1_[idx]) {
+                    table1_[idx].emplace(std::move(cur)); return true;
+                } else {
+                    // evict
+                    std::swap(cur, *table1_[idx]);
+                    table_id = 2;
+                }
+            } else {
+                size_t idx = h2_(cur.first, capacity_);
+                if (!table2_[idx]) {
+                    table2_[idx].emplace(std::move(cur)); return true;
+                } else {
+                    std::swap(cur, *table2_[idx]);
+                    table_id = 1;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Elements are moved from the old tables straight into the new ones; no
+    // temporary copy of the contents and no duplicate checks.
+    void rehash(size_t new_cap) {
+        OpStats::Rehash timer(op_stats_);
+        new_cap = next_prime(std::max<size_t>(new_cap, 3));
+        auto old1 = std::move(table1_);
+        auto old2 = std::move(table2_);
+        capacity_ = new_cap;
+        table1_.assign(capacity_, std::nullopt);
+        table2_.assign(capacity_, std::nullopt);
+        std::vector<std::pair<Key,Value>> homeless;
+        for (auto* old : {&old1, &old2}) {
+            for (auto &o : *old) {
+                if (!o) continue;
+                std::pair<Key,Value> cur = std::move(*o);
+                if (!place(cur)) homeless.push_back(std::move(cur));
+            }
+        }
+        if (homeless.empty()) return;
+        rehash(next_prime(capacity_ * 2));
+        for (auto &cur : homeless) while (!place(cur)) rehash(next_prime(capacity_ * 2));
+    }
+};
+
+// -----------------------------
+// Bucketized cuckoo hashing: every key has two candidate buckets of kSlots
+// slots. A one-byte tag per slot (high bits of the hash, 0 = free) screens
+// slots before any key comparison, and the alternate bucket is derived from
+// the tag alone (b ^ f(tag)), so eviction paths are searched without touching
+// keys. When both buckets are full a breadth-first search finds the shortest
+// chain of moves ending in a free slot; with four slots per bucket this keeps
+// working above 90% load, and the search is capped at kMaxBfsNodes buckets.
+// If that fails below half of max_load, the cause is keys with equal hashes
+// (a weak hash policy, e.g. MidSquareHash on small sequential keys), which no
+// table size separates: the key goes to an overflow stash, chained per first
+// bucket. Lookups only consult it while it is non-empty.
+// -----------------------------
+template <
+    typename Key,
+    typename Value,
+    typename HashPolicy = DivisionHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class BucketizedCuckooHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hash_policy = HashPolicy;
+    using allocator_type = Allocator;
+    static constexpr size_t kSlots = 4;
+
+    explicit BucketizedCuckooHashMap(size_t initial_capacity = 16, double max_load = 0.95,
+                                     const Allocator& alloc = Allocator())
+        : policy_(), eq_(), tags_(alloc), slots_(alloc), stash_(alloc), stash_head_(alloc), size_(0),
+          max_load_(std::min(max_load, 0.98)) {
+        allocate(next_pow2(std::max<size_t>(initial_capacity / kSlots, 2)));
+    }
+
+    bool insert(const Key& k, const Value& v) { return emplace_impl(k, true, v); }
+    bool insert(Key&& k, Value&& v) { return emplace_impl(std::move(k), true, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...); }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    const Value* find_ptr(const Key& k) const { return lookup(k); }
+    Value* find_ptr(const Key& k) { return const_cast<Value*>(lookup(k)); }
+
+    bool contains(const Key& k) const { return lookup(k) != nullptr; }
+
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return lookup(k); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    Value* find_ptr(const K& k) { return const_cast<Value*>(lookup(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return lookup(k) != nullptr; }
+
+    bool erase(const Key& k) {
+        size_t pos = locate(k);
+        if (pos != npos) tags_[pos] = 0; // no tombstones: a free slot never ends a lookup
+        else if (stash_.empty() || !unstash(k)) return false;
+        --size_;
+        return true;
+    }
+
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return tags_.size(); }
+    double load_factor() const noexcept { return static_cast<double>(size_) / tags_.size(); }
+    void clear() {
+        allocate(bucket_mask_ + 1);
+        size_ = 0;
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t i = 0; i < tags_.size(); ++i)
+            if (tags_[i]) f(slots_[i].first, slots_[i].second);
+        for (const auto& e : stash_) f(e.kv.first, e.kv.second);
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        for (size_t i = 0; i < tags_.size(); ++i)
+            if (tags_[i]) f(std::as_const(slots_[i].first), slots_[i].second);
+        for (auto& e : stash_) f(std::as_const(e.kv.first), e.kv.second);
+    }
+
+    // Elements kept in the overflow stash.
+    size_t stash_size() const noexcept { return stash_.size(); }
+
+    // Load over all slots (no tombstones, no probe chains; a lookup checks one
+    // or two buckets), plus the HASHING_STATS counters.
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size_, tags_.size(), 0, 0);
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return allocator_type(tags_.get_allocator()); }
+
+    // Larger if the eviction search fails in the smallest table.
+    void shrink_to_fit() { rehash(buckets_for(size_)); }
+
+    void reserve(size_t n) {
+        size_t want = buckets_for(n);
+        if (want > bucket_mask_ + 1) rehash(want);
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup = false) {
+        if (dedup) {
+            // naive dedup: sort by key and insert unique
+            std::vector<std::pair<Key,Value>> tmp = items;
+            std::sort(tmp.begin(), tmp.end(), [&](auto &a, auto &b){ return a.first < b.first; });
+            tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+            for (auto &kv : tmp) insert(kv.first, kv.second);
+        } else {
+            for (auto &kv : items) insert(kv.first, kv.second);
+        }
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t kMaxBfsNodes = 256;
+
+    HashPolicy policy_;
+    KeyEqual eq_;
+    alloc_vector<uint8_t, Allocator> tags_;                // kSlots per bucket, 0 = free
+    alloc_vector<std::pair<Key,Value>, Allocator> slots_;  // parallel to tags_
+    struct StashEntry {
+        std::pair<Key,Value> kv;
+        uint32_t next; // 1 + index of the next entry with the same first bucket, 0 if last
+    };
+    alloc_vector<StashEntry, Allocator> stash_;
+    alloc_vector<uint32_t, Allocator> stash_head_; // per bucket, like next; allocated on first use
+    size_t bucket_mask_;
+    size_t size_;
+    double max_load_;
+    OpStats op_stats_;
+
+    // power-of-two bucket count holding n elements below max_load_
+    size_t buckets_for(size_t n) const {
+        return next_pow2(std::max<size_t>(static_cast<size_t>(n / (kSlots * max_load_)) + 1, 2));
+    }
+
+    void allocate(size_t buckets) {
+        bucket_mask_ = buckets - 1;
+        tags_.assign(buckets * kSlots, 0);
+        slots_.clear();
+        slots_.resize(buckets * kSlots);
+        stash_.clear();
+        stash_head_.clear();
+    }
+
+    template <typename K>
+    uint64_t hash(const K& k) const { return mix64(policy_(k, kHashRange)); }
+    static uint8_t tag_of(uint64_t h) noexcept {
+        uint8_t t = static_cast<uint8_t>(h >> 56);
+        return t ? t : 1;
+    }
+    // an involution: alt_bucket(alt_bucket(b, t), t) == b
+    size_t alt_bucket(size_t b, uint8_t tag) const noexcept {
+        return (b ^ (tag * 0x5bd1e995ULL)) & bucket_mask_;
+    }
+
+    template <typename K>
+    size_t find_in(size_t b, uint8_t tag, const K& k) const {
+        for (size_t s = b * kSlots, e = s + kSlots; s < e; ++s)
+            if (tags_[s] == tag && eq_(slots_[s].first, k)) return s;
+        return npos;
+    }
+    size_t free_in(size_t b) const {
+        for (size_t s = b * kSlots, e = s + kSlots; s < e; ++s)
+            if (tags_[s] == 0) return s;
+        return npos;
+    }
+
+    template <typename K>
+    size_t locate(const K& k) const {
+        uint64_t h = hash(k);
+        uint8_t tag = tag_of(h);
+        size_t b = h & bucket_mask_;
+        OpStats::Probe probes(op_stats_);
+        probes.step();
+        size_t pos = find_in(b, tag, k);
+        if (pos != npos) return pos;
+        probes.step();
+        return find_in(alt_bucket(b, tag), tag, k);
+    }
+
+    template <typename K>
+    const Value* lookup(const K& k) const {
+        size_t pos = locate(k);
+        if (pos != npos) return &slots_[pos].second;
+        return stash_.empty() ? nullptr : stash_find(k);
+    }
+
+    template <typename K>
+    const Value* stash_find(const K& k) const {
+        OpStats::Probe probes(op_stats_);
+        for (uint32_t i = stash_head_[hash(k) & bucket_mask_]; i; i = stash_[i - 1].next) {
+            probes.step();
+            if (eq_(stash_[i - 1].kv.first, k)) return &stash_[i - 1].kv.second;
+        }
+        return nullptr;
+    }
+
+    // Unlinks k from its stash chain; the last entry fills the hole, so the
+    // link to it is redirected.
+    bool unstash(const Key& k) {
+        uint32_t* link = &stash_head_[hash(k) & bucket_mask_];
+        while (*link && !eq_(stash_[*link - 1].kv.first, k)) link = &stash_[*link - 1].next;
+        if (!*link) return false;
+        uint32_t i = *link;
+        *link = stash_[i - 1].next;
+        uint32_t last = static_cast<uint32_t>(stash_.size());
+        if (i != last) {
+            link = &stash_head_[hash(stash_[last - 1].kv.first) & bucket_mask_];
+            while (*link != last) link = &stash_[*link - 1].next;
+            *link = i;
+            stash_[i - 1] = std::move(stash_[last - 1]);
+        }
+        stash_.pop_back();
+        return true;
+    }
+
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        if (const Value* v = lookup(k)) {
+            if (assign) assign_from(*const_cast<Value*>(v), std::forward<Args>(args)...);
+            return false;
+        }
+        if ((size_ + 1) > static_cast<size_t>(tags_.size() * max_load_))
+            rehash(2 * (bucket_mask_ + 1));
+        put(std::pair<Key,Value>(std::forward<K>(k), Value(std::forward<Args>(args)...)));
+        ++size_;
+        return true;
+    }
+
+    // Stores kv (known absent). If the eviction search fails the table grows
+    // once it is half way to max_load_; below that only equal hashes fill
+    // both buckets, and kv goes to the stash.
+    void put(std::pair<Key,Value>&& kv) {
+        uint64_t h = hash(kv.first);
+        size_t pos;
+        while ((pos = make_room(h)) == npos) {
+            if (size_ < tags_.size() * max_load_ / 2) {
+                size_t b = h & bucket_mask_;
+                if (stash_head_.empty()) stash_head_.assign(bucket_mask_ + 1, 0);
+                stash_.push_back(StashEntry{std::move(kv), stash_head_[b]});
+                stash_head_[b] = static_cast<uint32_t>(stash_.size());
+                return;
+            }
+            rehash(2 * (bucket_mask_ + 1));
+        }
+        tags_[pos] = tag_of(h);
+        slots_[pos] = std::move(kv);
+    }
+
+    // Returns a free slot in one of h's buckets, first shifting a chain of
+    // elements to their alternate buckets if both are full; npos if the BFS
+    // finds no free slot within kMaxBfsNodes buckets.
+    size_t make_room(uint64_t h) {
+        uint8_t tag = tag_of(h);
+        size_t b1 = h & bucket_mask_, b2 = alt_bucket(b1, tag);
+        size_t pos = free_in(b1);
+        if (pos == npos) pos = free_in(b2);
+        if (pos != npos) return pos;
+
+        // node = bucket reached by moving slot `from` out of its parent's bucket
+        struct Node { size_t bucket, parent, from; };
+        std::vector<Node> nodes{{b1, npos, 0}, {b2, npos, 0}};
+        for (size_t n = 0; n < nodes.size() && nodes.size() < kMaxBfsNodes; ++n) {
+            size_t b = nodes[n].bucket;
+            for (size_t s = b * kSlots, e = s + kSlots; s < e; ++s) {
+                size_t alt = alt_bucket(b, tags_[s]);
+                nodes.push_back({alt, n, s});
+                size_t hole = free_in(alt);
+                if (hole == npos) continue;
+                // walk back to the root, each element moving into the hole after it
+                for (size_t i = nodes.size() - 1; nodes[i].parent != npos; i = nodes[i].parent) {
+                    size_t src = nodes[i].from;
+                    tags_[hole] = tags_[src];
+                    slots_[hole] = std::move(slots_[src]);
+                    tags_[src] = 0;
+                    hole = src;
+                }
+                return hole;
+            }
+        }
+        return npos;
+    }
+
+    void rehash(size_t new_buckets) {
+        OpStats::Rehash timer(op_stats_);
+        auto old_tags = std::move(tags_);
+        auto old_slots = std::move(slots_);
+        auto old_stash = std::move(stash_);
+        allocate(new_buckets);
+        for (size_t i = 0; i < old_tags.size(); ++i)
+            if (old_tags[i]) put(std::move(old_slots[i]));
+        for (auto& e : old_stash) put(std::move(e.kv));
+    }
+};
+
+// -----------------------------
+// Concurrent cuckoo map (same bucket/tag scheme as BucketizedCuckooHashMap).
+// Readers take no locks and never write shared memory: each bucket maps to a
+// stripe whose version counter is odd while a writer holds it, and a lookup
+// copies its two buckets between two version reads, retrying if either
+// changed. Writers lock just the stripes of the key's two buckets. An insert
+// that needs an eviction chain searches for it without locks, then locks the
+// stripes along the chain and re-checks it before moving anything; only a
+// resize locks every stripe. Keys that find no chain at low load (a weak hash
+// policy) go to a small stash after the bucket slots, under one extra stripe.
+// Slots are arrays of atomic words so the optimistic copies are race-free,
+// which limits Key and Value to trivially copyable types. Replaced tables are
+// kept until destruction (a reader may still be scanning one); their total
+// size is below that of the live table.
+// -----------------------------
+template <
+    typename Key,
+    typename Value,
+    typename HashPolicy = DivisionHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class ConcurrentCuckooHashMap {
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "ConcurrentCuckooHashMap copies slots word by word");
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hash_policy = HashPolicy;
+    using allocator_type = Allocator;
+    static constexpr size_t kSlots = 4;
+    static constexpr size_t kStripes = 1024;
+
+    explicit ConcurrentCuckooHashMap(size_t initial_capacity = 16, double max_load = 0.9,
+                                     const Allocator& alloc = Allocator())
+        : policy_(), eq_(), stripes_(new Stripe[kStripes + 1]), size_(0), max_load_(std::min(max_load, 0.95)) {
+        table_.store(new Table(next_pow2(std::max<size_t>(initial_capacity / kSlots, 2)), alloc),
+                     std::memory_order_relaxed);
+    }
+    ~ConcurrentCuckooHashMap() { delete table_.load(std::memory_order_relaxed); }
+    ConcurrentCuckooHashMap(const ConcurrentCuckooHashMap&) = delete;
+    ConcurrentCuckooHashMap& operator=(const ConcurrentCuckooHashMap&) = delete;
+
+    bool insert(const Key& k, const Value& v) { return write(k, v, true); }
+    bool try_emplace(const Key& k, const Value& v) { return write(k, v, false); }
+
+    // Lock-free lookups; find returns a copy taken from a consistent snapshot.
+    std::optional<Value> find(const Key& k) const {
+        std::optional<Value> v;
+        if (!read(k, &v)) return std::nullopt;
+        return v;
+    }
+    bool contains(const Key& k) const { return read(k, nullptr); }
+
+    bool erase(const Key& k) {
+        uint64_t h = hash(k);
+        uint8_t tag = tag_of(h);
+        OpStats::Probe probes(op_stats_);
+        for (;;) {
+            probes.step();
+            Table* t = table_.load(std::memory_order_acquire);
+            size_t b1 = h & t->bucket_mask, b2 = t->alt_bucket(b1, tag);
+            lock_pair(b1, b2);
+            if (table_.load(std::memory_order_relaxed) != t) { // resized while we waited
+                unlock_pair(b1, b2);
+                continue;
+            }
+            size_t pos = find_in(*t, b1, tag, k);
+            if (pos == npos) pos = find_in(*t, b2, tag, k);
+            if (pos != npos) {
+                t->set_tag(pos, 0);
+                size_.fetch_sub(1, std::memory_order_relaxed);
+            } else if (t->stash_used.load(std::memory_order_relaxed)) {
+                lock(kStripes);
+                pos = stash_find(*t, h, k);
+                if (pos != npos) {
+                    unstash(*t, h, pos);
+                    size_.fetch_sub(1, std::memory_order_relaxed);
+                }
+                unlock(kStripes);
+            }
+            unlock_pair(b1, b2);
+            return pos != npos;
+        }
+    }
+
+    size_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+    size_t capacity() const noexcept { return table_.load(std::memory_order_acquire)->slots(); }
+    size_t stash_size() const noexcept {
+        return table_.load(std::memory_order_acquire)->stash_used.load(std::memory_order_relaxed);
+    }
+    void clear() {
+        lock_all();
+        Table* t = table_.load(std::memory_order_relaxed);
+        for (size_t s = 0; s < t->total(); ++s) t->set_tag(s, 0);
+        for (size_t i = 0; i < 2 * t->stash_cap; ++i) t->links[i].store(0, std::memory_order_relaxed);
+        t->stash_used.store(0, std::memory_order_relaxed);
+        size_.store(0, std::memory_order_relaxed);
+        unlock_all();
+    }
+
+    // Load over all slots, plus the HASHING_STATS counters (one probe per
+    // optimistic read attempt, so retries show up in the histogram). With
+    // HASHING_STATS on, readers do write the shared counters.
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size(), capacity(), 0, 0);
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return table_.load(std::memory_order_acquire)->alloc; }
+
+    // Grows once for n elements in total. There is no shrinking: replaced
+    // tables stay allocated for readers, so a smaller live table would only
+    // add memory.
+    void reserve(size_t n) {
+        lock_all();
+        Table* t = table_.load(std::memory_order_relaxed);
+        while (n > static_cast<size_t>(t->slots() * max_load_)) t = grow(t);
+        unlock_all();
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup = false) {
+        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
+        std::vector<std::pair<Key,Value>> tmp = items;
+        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
+        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+        for (auto &kv : tmp) insert(kv.first, kv.second);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t kMaxBfsNodes = 256;
+
+    struct Entry {
+        Key key;
+        Value value;
+    };
+    static constexpr size_t kWords = (sizeof(Entry) + 7) / 8;
+
+    struct Table {
+        size_t bucket_mask;
+        size_t stash_cap;                   // stash slots after the bucket slots; a power of 2
+        std::atomic<size_t> stash_used{0};  // changed under the stash stripe
+        Allocator alloc;
+        std::atomic<uint8_t>* tags;   // kSlots per bucket, 0 = free
+        std::atomic<uint64_t>* words; // kWords per slot
+        // stash_cap chain heads (by hash), then stash_cap next links;
+        // 1 + stash index, 0 = none
+        std::atomic<uint32_t>* links;
+        Table* retired = nullptr;     // previous table, kept for readers
+
+        Table(size_t buckets, const Allocator& a)
+            : bucket_mask(buckets - 1), stash_cap(std::max<size_t>(kSlots, buckets / 4)), alloc(a) {
+            tags = make<std::atomic<uint8_t>>(total());
+            try {
+                words = make<std::atomic<uint64_t>>(total() * kWords);
+                try {
+                    links = make<std::atomic<uint32_t>>(2 * stash_cap);
+                } catch (...) {
+                    unmake(words, total() * kWords);
+                    throw;
+                }
+            } catch (...) {
+                unmake(tags, total());
+                throw;
+            }
+        }
+        ~Table() {
+            unmake(tags, total());
+            unmake(words, total() * kWords);
+            unmake(links, 2 * stash_cap);
+            delete retired;
+        }
+        Table(const Table&) = delete;
+        Table& operator=(const Table&) = delete;
+
+        // zeroed arrays of atomics from the map's allocator
+        template <typename T>
+        T* make(size_t n) {
+            rebind_alloc_t<Allocator, T> a(alloc);
+            T* p = std::allocator_traits<rebind_alloc_t<Allocator, T>>::allocate(a, n);
+            for (size_t i = 0; i < n; ++i) ::new (static_cast<void*>(p + i)) T(0);
+            return p;
+        }
+        template <typename T>
+        void unmake(T* p, size_t n) noexcept {
+            rebind_alloc_t<Allocator, T> a(alloc);
+            std::allocator_traits<rebind_alloc_t<Allocator, T>>::deallocate(a, p, n);
+        }
+
+        size_t slots() const noexcept { return (bucket_mask + 1) * kSlots; }
+        size_t total() const noexcept { return slots() + stash_cap; }
+        std::atomic<uint32_t>& head(uint64_t h) noexcept { return links[h & (stash_cap - 1)]; }
+        const std::atomic<uint32_t>& head(uint64_t h) const noexcept { return links[h & (stash_cap - 1)]; }
+        std::atomic<uint32_t>& next(size_t i) noexcept { return links[stash_cap + i]; }
+        const std::atomic<uint32_t>& next(size_t i) const noexcept { return links[stash_cap + i]; }
+        size_t alt_bucket(size_t b, uint8_t tag) const noexcept {
+            return (b ^ (tag * 0x5bd1e995ULL)) & bucket_mask;
+        }
+        uint8_t tag(size_t s) const noexcept { return tags[s].load(std::memory_order_relaxed); }
+        void set_tag(size_t s, uint8_t t) noexcept { tags[s].store(t, std::memory_order_relaxed); }
+        // copies into raw storage, so Key and Value need no default constructor
+        Entry load(size_t s) const noexcept {
+            alignas(Entry) unsigned char buf[kWords * 8];
+            for (size_t w = 0; w < kWords; ++w) {
+                uint64_t x = words[s * kWords + w].load(std::memory_order_relaxed);
+                std::memcpy(buf + w * 8, &x, 8);
+            }
+            return *std::launder(reinterpret_cast<const Entry*>(buf));
+        }
+        void store(size_t s, const Entry& e) noexcept {
+            uint64_t buf[kWords] = {};
+            std::memcpy(buf, &e, sizeof(Entry));
+            for (size_t w = 0; w < kWords; ++w) words[s * kWords + w].store(buf[w], std::memory_order_relaxed);
+        }
+        void move(size_t from, size_t to) noexcept {
+            store(to, load(from));
+            set_tag(to, tag(from));
+            set_tag(from, 0);
+        }
+    };
+
+    // seqlock version; odd while a writer holds the stripe
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> version{0};
+    };
+
+    // Result of an insert attempt under the key's stripes.
+    enum class Put { Found, Inserted, Full, NoSlot };
+
+    HashPolicy policy_;
+    KeyEqual eq_;
+    std::atomic<Table*> table_;
+    std::unique_ptr<Stripe[]> stripes_; // kStripes for buckets, then one for the stash
+    std::atomic<size_t> size_;
+    double max_load_;
+    OpStats op_stats_;
+
+    template <typename K>
+    uint64_t hash(const K& k) const { return mix64(policy_(k, kHashRange)); }
+    static uint8_t tag_of(uint64_t h) noexcept {
+        uint8_t t = static_cast<uint8_t>(h >> 56);
+        return t ? t : 1;
+    }
+    static size_t stripe(size_t b) noexcept { return b & (kStripes - 1); }
+
+    void lock(size_t s) {
+        std::atomic<uint64_t>& v = stripes_[s].version;
+        for (;;) {
+            uint64_t cur = v.load(std::memory_order_relaxed);
+            if (!(cur & 1) && v.compare_exchange_weak(cur, cur + 1, std::memory_order_acquire)) break;
+            std::this_thread::yield();
+        }
+        // orders the odd version before the slot writes that follow
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void unlock(size_t s) { stripes_[s].version.fetch_add(1, std::memory_order_release); }
+
+    // stripes are always taken in ascending order, the stash stripe last
+    void lock_pair(size_t b1, size_t b2) {
+        size_t s1 = std::min(stripe(b1), stripe(b2)), s2 = std::max(stripe(b1), stripe(b2));
+        lock(s1);
+        if (s2 != s1) lock(s2);
+    }
+    void unlock_pair(size_t b1, size_t b2) {
+        size_t s1 = stripe(b1), s2 = stripe(b2);
+        unlock(s1);
+        if (s2 != s1) unlock(s2);
+    }
+    void lock_all() { for (size_t s = 0; s <= kStripes; ++s) lock(s); }
+    void unlock_all() { for (size_t s = 0; s <= kStripes; ++s) unlock(s); }
+
+    size_t find_in(const Table& t, size_t b, uint8_t tag, const Key& k) const {
+        for (size_t s = b * kSlots, e = s + kSlots; s < e; ++s)
+            if (t.tag(s) == tag && eq_(t.load(s).key, k)) return s;
+        return npos;
+    }
+    static size_t free_in(const Table& t, size_t b) {
+        for (size_t s = b * kSlots, e = s + kSlots; s < e; ++s)
+            if (t.tag(s) == 0) return s;
+        return npos;
+    }
+
+    // Stash helpers: entries sit in slots() + i, chained by hash. The caller
+    // holds the stash stripe (or every stripe), except for read().
+    size_t stash_find(const Table& t, uint64_t h, const Key& k) const {
+        uint8_t tag = tag_of(h);
+        // the bound keeps a reader on a chain that is being relinked from looping
+        size_t steps = t.stash_cap;
+        for (uint32_t i = t.head(h).load(std::memory_order_relaxed); i && steps--;
+             i = t.next(i - 1).load(std::memory_order_relaxed)) {
+            size_t s = t.slots() + i - 1;
+            if (t.tag(s) == tag && eq_(t.load(s).key, k)) return s;
+        }
+        return npos;
+    }
+    // Unlinks pos, then moves the last entry into the gap and repoints its link.
+    void unstash(Table& t, uint64_t h, size_t pos) {
+        uint32_t i = static_cast<uint32_t>(pos - t.slots());
+        link_to(t, h, i).store(t.next(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        uint32_t last = static_cast<uint32_t>(t.stash_used.load(std::memory_order_relaxed) - 1);
+        if (i != last) {
+            t.move(t.slots() + last, pos);
+            link_to(t, hash(t.load(pos).key), last).store(i + 1, std::memory_order_relaxed);
+            t.next(i).store(t.next(last).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        } else {
+            t.set_tag(pos, 0);
+        }
+        t.stash_used.store(last, std::memory_order_relaxed);
+    }
+    // the head or next link that points at stash entry i of chain h
+    static std::atomic<uint32_t>& link_to(Table& t, uint64_t h, uint32_t i) {
+        std::atomic<uint32_t>* link = &t.head(h);
+        for (uint32_t j; (j = link->load(std::memory_order_relaxed)) != i + 1;) link = &t.next(j - 1);
+        return *link;
+    }
+    static bool stash(Table& t, const Entry& e, uint64_t h) {
+        size_t i = t.stash_used.load(std::memory_order_relaxed);
+        if (i == t.stash_cap) return false;
+        t.store(t.slots() + i, e);
+        t.set_tag(t.slots() + i, tag_of(h));
+        t.next(i).store(t.head(h).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        t.head(h).store(static_cast<uint32_t>(i + 1), std::memory_order_relaxed);
+        t.stash_used.store(i + 1, std::memory_order_relaxed);
+        return true;
+    }
+    // weak hashes only: at half the load limit a resize is the better fix
+    bool stash_allowed(const Table& t) const {
+        return size_.load(std::memory_order_relaxed) < static_cast<size_t>(t.slots() * max_load_ / 2);
+    }
+
+    // Optimistic lookup: copy out, then retry if a writer touched either stripe
+    // (or the stash stripe, when the stash was searched).
+    bool read(const Key& k, std::optional<Value>* out) const {
+        uint64_t h = hash(k);
+        uint8_t tag = tag_of(h);
+        OpStats::Probe probes(op_stats_);
+        for (;;) {
+            probes.step();
+            const Table* t = table_.load(std::memory_order_acquire);
+            size_t b1 = h & t->bucket_mask, b2 = t->alt_bucket(b1, tag);
+            const std::atomic<uint64_t>& v1 = stripes_[stripe(b1)].version;
+            const std::atomic<uint64_t>& v2 = stripes_[stripe(b2)].version;
+            const std::atomic<uint64_t>& vs = stripes_[kStripes].version;
+            uint64_t s1 = v1.load(std::memory_order_acquire), s2 = v2.load(std::memory_order_acquire), ss = 0;
+            if ((s1 | s2) & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (table_.load(std::memory_order_acquire) != t) continue; // resized in between
+            bool found = false, stashed = false;
+            for (size_t b : {b1, b2}) {
+                for (size_t s = b * kSlots, e = s + kSlots; s < e && !found; ++s) {
+                    if (t->tag(s) != tag) continue;
+                    Entry en = t->load(s);
+                    if (!eq_(en.key, k)) continue;
+                    if (out) out->emplace(en.value);
+                    found = true;
+                }
+            }
+            if (!found && t->stash_used.load(std::memory_order_acquire)) {
+                ss = vs.load(std::memory_order_acquire);
+                if (ss & 1) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                stashed = true;
+                size_t s = stash_find(*t, h, k);
+                if (s != npos && out) out->emplace(t->load(s).value);
+                found = s != npos;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (v1.load(std::memory_order_relaxed) == s1 && v2.load(std::memory_order_relaxed) == s2 &&
+                (!stashed || vs.load(std::memory_order_relaxed) == ss))
+                return found;
+        }
+    }
+
+    // Caller holds the stripes of b1 and b2 (and the stash stripe if
+    // stash_held) and has checked that t is live.
+    Put put_locked(Table& t, uint64_t h, size_t b1, size_t b2, const Key& k, const Value& v, bool assign,
+                   bool stash_held) {
+        uint8_t tag = tag_of(h);
+        size_t pos = find_in(t, b1, tag, k);
+        if (pos == npos) pos = find_in(t, b2, tag, k);
+        if (pos == npos && t.stash_used.load(std::memory_order_relaxed)) {
+            if (!stash_held) lock(kStripes);
+            pos = stash_find(t, h, k);
+            if (pos != npos && assign) t.store(pos, Entry{k, v});
+            if (!stash_held) unlock(kStripes);
+            if (pos != npos) return Put::Found;
+        }
+        if (pos != npos) {
+            if (assign) t.store(pos, Entry{k, v});
+            return Put::Found;
+        }
+        if (size_.load(std::memory_order_relaxed) + 1 > static_cast<size_t>(t.slots() * max_load_))
+            return Put::Full;
+        pos = free_in(t, b1);
+        if (pos == npos) pos = free_in(t, b2);
+        if (pos == npos) return Put::NoSlot;
+        t.store(pos, Entry{k, v});
+        t.set_tag(pos, tag);
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return Put::Inserted;
+    }
+
+    bool write(const Key& k, const Value& v, bool assign) {
+        uint64_t h = hash(k);
+        uint8_t tag = tag_of(h);
+        op_stats_.record(1);
+        for (;;) {
+            Table* t = table_.load(std::memory_order_acquire);
+            size_t b1 = h & t->bucket_mask, b2 = t->alt_bucket(b1, tag);
+            lock_pair(b1, b2);
+            if (table_.load(std::memory_order_relaxed) != t) { // resized while we waited
+                unlock_pair(b1, b2);
+                continue;
+            }
+            Put r = put_locked(*t, h, b1, b2, k, v, assign, false);
+            unlock_pair(b1, b2);
+            if (r == Put::NoSlot) r = put_evicting(t, h, b1, b2, k, v, assign);
+            if (r == Put::Found) return false;
+            if (r == Put::Inserted) return true;
+            if (r == Put::Full) {
+                lock_all();
+                if (table_.load(std::memory_order_relaxed) == t) grow(t);
+                unlock_all();
+            }
+            // NoSlot: the chain changed under us, start over
+        }
+    }
+
+    // Both of the key's buckets were full: finds an eviction chain without
+    // locks, then locks the stripes of every bucket on it, re-checks it and
+    // shifts it. With no chain the key goes to the stash at low load; Full
+    // asks the caller to grow.
+    Put put_evicting(Table* t, uint64_t h, size_t b1, size_t b2, const Key& k, const Value& v, bool assign) {
+        std::vector<size_t> path, held{stripe(b1), stripe(b2)};
+        size_t to = find_path(*t, b1, b2, path);
+        if (to != npos) {
+            held.push_back(stripe(to));
+            for (size_t s : path) held.push_back(stripe(s / kSlots));
+        }
+        std::sort(held.begin(), held.end());
+        held.erase(std::unique(held.begin(), held.end()), held.end());
+        if (to == npos) held.push_back(kStripes);
+        for (size_t s : held) lock(s);
+        Put r = Put::NoSlot;
+        if (table_.load(std::memory_order_relaxed) == t) {
+            r = put_locked(*t, h, b1, b2, k, v, assign, to == npos);
+            if (r == Put::NoSlot && to != npos) {
+                size_t pos = shift(*t, path, to);
+                if (pos != npos) {
+                    t->store(pos, Entry{k, v});
+                    t->set_tag(pos, tag_of(h));
+                    size_.fetch_add(1, std::memory_order_relaxed);
+                    r = Put::Inserted;
+                }
+            } else if (r == Put::NoSlot) {
+                r = stash_allowed(*t) && stash(*t, Entry{k, v}, h) ? Put::Inserted : Put::Full;
+                if (r == Put::Inserted) size_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        for (size_t s : held) unlock(s);
+        return r;
+    }
+
+    // Eviction chain for a key whose buckets b1 and b2 are full (BFS, as in
+    // BucketizedCuckooHashMap): path gets the slots to shift, the first in b1
+    // or b2, each moving to its alternate bucket where the next one sits.
+    // Returns the bucket that has room for the last, or npos. Reads only tags,
+    // so it runs without locks; shift() re-checks the result.
+    static size_t find_path(const Table& t, size_t b1, size_t b2, std::vector<size_t>& path) {
+        struct Node { size_t bucket, parent, from; };
+        std::vector<Node> nodes{{b1, npos, 0}, {b2, npos, 0}};
+        for (size_t n = 0; n < nodes.size() && nodes.size() < kMaxBfsNodes; ++n) {
+            size_t b = nodes[n].bucket;
+            for (size_t s = b * kSlots, e = s + kSlots; s < e; ++s) {
+                uint8_t tag = t.tag(s);
+                if (!tag) continue; // freed meanwhile; the locked retry will see it
+                size_t alt = t.alt_bucket(b, tag);
+                nodes.push_back({alt, n, s});
+                if (free_in(t, alt) == npos) continue;
+                path.clear();
+                for (size_t i = nodes.size() - 1; nodes[i].parent != npos; i = nodes[i].parent)
+                    path.push_back(nodes[i].from);
+                std::reverse(path.begin(), path.end());
+                // a slot visited twice would be shifted twice
+                std::vector<size_t> sorted = path;
+                std::sort(sorted.begin(), sorted.end());
+                if (std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end()) return alt;
+            }
+        }
+        return npos;
+    }
+
+    // Caller holds the stripes of every bucket on the chain (or owns t).
+    // Returns the freed slot at its start, or npos if the chain went stale.
+    static size_t shift(Table& t, const std::vector<size_t>& path, size_t to) {
+        for (size_t i = 0; i < path.size(); ++i) {
+            uint8_t tag = t.tag(path[i]);
+            size_t next = i + 1 < path.size() ? path[i + 1] / kSlots : to;
+            if (!tag || t.alt_bucket(path[i] / kSlots, tag) != next) return npos;
+        }
+        size_t hole = free_in(t, to);
+        if (hole == npos) return npos;
+        for (size_t i = path.size(); i-- > 0;) {
+            t.move(path[i], hole);
+            hole = path[i];
+        }
+        return hole;
+    }
+
+    // Free slot for hash h in a table no other thread can see yet.
+    static size_t make_room(Table& t, uint64_t h) {
+        size_t b1 = h & t.bucket_mask, b2 = t.alt_bucket(b1, tag_of(h));
+        size_t pos = free_in(t, b1);
+        if (pos == npos) pos = free_in(t, b2);
+        if (pos != npos) return pos;
+        std::vector<size_t> path;
+        size_t to = find_path(t, b1, b2, path);
+        return to == npos ? npos : shift(t, path, to);
+    }
+
+    // Caller holds every stripe. Builds a table twice the size (or larger if
+    // an element fits neither a bucket nor the stash) and publishes it; the
+    // old one stays readable.
+    Table* grow(Table* old) {
+        OpStats::Rehash timer(op_stats_);
+        size_t used = old->slots() + old->stash_used.load(std::memory_order_relaxed);
+        for (size_t buckets = 2 * (old->bucket_mask + 1);; buckets *= 2) {
+            std::unique_ptr<Table> t(new Table(buckets, old->alloc));
+            bool ok = true;
+            for (size_t s = 0; s < used && ok; ++s) {
+                if (!old->tag(s)) continue;
+                Entry e = old->load(s);
+                uint64_t h = hash(e.key);
+                size_t pos = make_room(*t, h);
+                if (pos == npos) {
+                    ok = stash(*t, e, h);
+                    continue;
+                }
+                t->store(pos, e);
+                t->set_tag(pos, tag_of(h));
+            }
+            if (!ok) continue;
+            t->retired = old;
+            table_.store(t.get(), std::memory_order_release);
+            return t.release();
+        }
+    }
+};
+
+// -----------------------------
+// Swiss-table style map: open addressing over groups of slots with a separate
+// control-byte array. Each control byte holds the low 7 bits of the slot's hash
+// (full) or a negative marker (empty / deleted), so a probe compares a whole
+// group of tags with one SIMD instruction and only touches the fat key/value
+// slots for tag matches.
+// -----------------------------
+
+// Control byte markers. Full slots store a tag in [0, 127], so the sign bit
+// alone tells full from free.
+constexpr int8_t kCtrlEmpty = -128;
+constexpr int8_t kCtrlDeleted = -2;
+
+// One group of control bytes; match*() return a bitmask with bit i set for
+// slot i of the group.
+struct CtrlGroup {
+#if defined(__AVX2__)
+    static constexpr size_t width = 32;
+    __m256i ctrl;
+    explicit CtrlGroup(const int8_t* p) noexcept
+        : ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) {}
+    uint32_t match(int8_t tag) const noexcept {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8(tag))));
+    }
+    // empty or deleted: sign bit set
+    uint32_t match_free() const noexcept {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(ctrl));
+    }
+#elif defined(HASHING_HAVE_SSE2)
+    static constexpr size_t width = 16;
+    __m128i ctrl;
+    explicit CtrlGroup(const int8_t* p) noexcept
+        : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+    uint32_t match(int8_t tag) const noexcept {
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag))));
+    }
+    uint32_t match_free() const noexcept {
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+    }
+#else
+    // portable fallback: plain byte loop over a smaller group
+    static constexpr size_t width = 8;
+    const int8_t* ctrl;
+    explicit CtrlGroup(const int8_t* p) noexcept : ctrl(p) {}
+    uint32_t match(int8_t tag) const noexcept {
+        uint32_t m = 0;
+        for (size_t i = 0; i < width; ++i) m |= static_cast<uint32_t>(ctrl[i] == tag) << i;
+        return m;
+    }
+    uint32_t match_free() const noexcept {
+        uint32_t m = 0;
+        for (size_t i = 0; i < width; ++i) m |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+        return m;
+    }
+#endif
+    uint32_t match_empty() const noexcept { return match(kCtrlEmpty); }
+};
+
+template <
+    typename Key,
+    typename Value,
+    typename Hasher = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class SwissHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hasher = Hasher;
+    using allocator_type = Allocator;
+
+    static constexpr size_t group_width = CtrlGroup::width;
+
+    explicit SwissHashMap(size_t initial_capacity = 16, double max_load = 0.875, const Allocator& alloc = Allocator())
+        : hash_(), eq_(), ctrl_(alloc), slots_(alloc), size_(0), deleted_count_(0), max_load_(max_load) {
+        allocate(initial_capacity);
+    }
+
+    bool insert(const Key& k, const Value& v) { return emplace_impl(k, true, v); }
+    bool insert(Key&& k, Value&& v) { return emplace_impl(std::move(k), true, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...); }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    const Value* find_ptr(const Key& k) const { return value_ptr(locate(k)); }
+    Value* find_ptr(const Key& k) { return value_ptr(locate(k)); }
+
+    bool contains(const Key& k) const { return locate(k) != npos; }
+
+    // Heterogeneous lookups need a transparent Hasher too, see StringViewHash.
+    template <typename K, typename = transparent_key_t<K, Hasher, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, Hasher, KeyEqual>>
+    Value* find_ptr(const K& k) { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, Hasher, KeyEqual>>
+    bool contains(const K& k) const { return locate(k) != npos; }
+
+    bool erase(const Key& k) {
+        size_t idx = locate(k);
+        if (idx == npos) return false;
+        // A group that still has an empty slot ends every probe that reaches
+        // it, so the slot can go straight back to empty; otherwise a
+        // tombstone keeps later groups reachable.
+        CtrlGroup grp(&ctrl_[idx - idx % group_width]);
+        if (grp.match_empty()) {
+            ctrl_[idx] = kCtrlEmpty;
+        } else {
+            ctrl_[idx] = kCtrlDeleted;
+            ++deleted_count_;
+        }
+        --size_;
+        after_erase();
+        return true;
+    }
+
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return capacity_; }
+    void clear() noexcept {
+        ctrl_.assign(capacity_, kCtrlEmpty);
+        slots_.clear();
+        slots_.resize(capacity_);
+        size_ = 0;
+        deleted_count_ = 0;
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (ctrl_[i] >= 0) f(slots_[i].first, slots_[i].second);
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        for (size_t i = 0; i < capacity_; ++i)
+            if (ctrl_[i] >= 0) f(std::as_const(slots_[i].first), slots_[i].second);
+    }
+
+    // Load, tombstones and clustering (longest run of non-empty slots), plus
+    // the HASHING_STATS counters (one probe per control group scanned).
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size_, capacity_, deleted_count_,
+                       longest_run(capacity_, [this](size_t i) { return ctrl_[i] != kCtrlEmpty; }));
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return allocator_type(ctrl_.get_allocator()); }
+
+    // Drops every tombstone in place, without a second table: full slots are
+    // marked deleted (= not re-placed yet) and each is moved to the first
+    // group on its probe sequence with a free or not-yet-placed slot, staying
+    // put if that is its own group and swapping if the slot is taken. Inserts
+    // do this instead of a same-size rehash when tombstones outnumber
+    // elements, and so does erase once they also fill a quarter of the table.
+    void purge_tombstones() {
+        OpStats::Rehash timer(op_stats_);
+        for (int8_t& c : ctrl_) c = c == kCtrlDeleted ? kCtrlEmpty : c >= 0 ? kCtrlDeleted : c;
+        for (size_t i = 0; i < capacity_; ++i) {
+            while (ctrl_[i] == kCtrlDeleted) {
+                uint64_t h = full_hash(slots_[i].first);
+                size_t g = home_group(h), idx;
+                for (size_t probe = 0;; g = (g + ++probe) & group_mask_) {
+                    uint32_t free = CtrlGroup(&ctrl_[g * group_width]).match_free();
+                    if (free) {
+                        idx = g * group_width + lowest_bit(free);
+                        break;
+                    }
+                }
+                if (idx / group_width == i / group_width) {
+                    ctrl_[i] = tag_of(h);
+                } else if (ctrl_[idx] == kCtrlEmpty) {
+                    slots_[idx] = std::move(slots_[i]);
+                    ctrl_[idx] = tag_of(h);
+                    ctrl_[i] = kCtrlEmpty;
+                } else {
+                    std::swap(slots_[i], slots_[idx]);
+                    ctrl_[idx] = tag_of(h);
+                }
+            }
+        }
+        deleted_count_ = 0;
+    }
+
+    void set_shrink_load(double min_load) {
+        check_shrink_load(min_load, max_load_);
+        shrink_load_ = min_load;
+    }
+
+    void shrink_to_fit() { rehash(static_cast<size_t>(size_ / max_load_) + 1); }
+
+    void reserve(size_t n) {
+        size_t want = static_cast<size_t>(n / max_load_) + 1;
+        if (want > capacity_) rehash(want);
+        else if (deleted_count_) purge_tombstones();
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
+        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
+        std::vector<std::pair<Key,Value>> tmp = items;
+        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
+        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+        for (auto &kv : tmp) insert(kv.first, kv.second);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    Hasher hash_;
+    KeyEqual eq_;
+    size_t capacity_;   // num_groups_ * group_width, a power of two
+    size_t num_groups_;
+    size_t group_mask_;
+    alloc_vector<int8_t, Allocator> ctrl_;
+    alloc_vector<std::pair<Key,Value>, Allocator> slots_;
+    size_t size_;
+    size_t deleted_count_;
+    double max_load_;
+    double shrink_load_ = 0;
+    OpStats op_stats_;
+
+    template <typename K>
+    uint64_t full_hash(const K& k) const {
+        return mix64(static_cast<uint64_t>(hash_(k)));
+    }
+    static int8_t tag_of(uint64_t h) noexcept { return static_cast<int8_t>(h & 0x7f); }
+    size_t home_group(uint64_t h) const noexcept { return static_cast<size_t>(h >> 7) & group_mask_; }
+
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        if ((size_ + deleted_count_ + 1) > static_cast<size_t>(capacity_ * max_load_)) {
+            // mostly tombstones -> clean up at the same size, otherwise grow
+            if (deleted_count_ > size_) purge_tombstones();
+            else rehash(capacity_ * 2);
+        }
+        uint64_t h = full_hash(k);
+        int8_t tag = tag_of(h);
+        size_t free_idx = npos;
+        size_t g = home_group(h);
+        OpStats::Probe probes(op_stats_);
+        for (size_t probe = 0; probe < num_groups_; g = (g + ++probe) & group_mask_) {
+            probes.step();
+            size_t base = g * group_width;
+            CtrlGroup grp(&ctrl_[base]);
+            for (uint32_t m = grp.match(tag); m; m &= m - 1) {
+                auto &slot = slots_[base + lowest_bit(m)];
+                if (eq_(slot.first, k)) {
+                    if (assign) assign_from(slot.second, std::forward<Args>(args)...); // update
+                    return false;
+                }
+            }
+            uint32_t free = grp.match_free();
+            if (free_idx == npos && free) free_idx = base + lowest_bit(free);
+            if (grp.match_empty()) break; // key cannot be further along
+        }
+        if (free_idx == npos) { // table full (shouldn't happen thanks to resize)
+            rehash(capacity_ * 2);
+            return emplace_impl(std::forward<K>(k), assign, std::forward<Args>(args)...);
+        }
+        if (ctrl_[free_idx] == kCtrlDeleted) --deleted_count_;
+        ctrl_[free_idx] = tag;
+        slots_[free_idx].first = std::forward<K>(k);
+        assign_from(slots_[free_idx].second, std::forward<Args>(args)...);
+        ++size_;
+        return true;
+    }
+
+    void allocate(size_t cap) {
+        num_groups_ = next_pow2((std::max<size_t>(cap, 1) + group_width - 1) / group_width);
+        group_mask_ = num_groups_ - 1;
+        capacity_ = num_groups_ * group_width;
+        ctrl_.assign(capacity_, kCtrlEmpty);
+        slots_.clear();
+        slots_.resize(capacity_);
+    }
+
+    const Value* value_ptr(size_t idx) const { return idx == npos ? nullptr : &slots_[idx].second; }
+    Value* value_ptr(size_t idx) { return idx == npos ? nullptr : &slots_[idx].second; }
+
+    // Triangular probing over groups visits every group once when the group
+    // count is a power of two.
+    template <typename K>
+    size_t locate(const K& k) const {
+        uint64_t h = full_hash(k);
+        int8_t tag = tag_of(h);
+        size_t g = home_group(h);
+        OpStats::Probe probes(op_stats_);
+        for (size_t probe = 0; probe < num_groups_; g = (g + ++probe) & group_mask_) {
+            probes.step();
+            size_t base = g * group_width;
+            CtrlGroup grp(&ctrl_[base]);
+            for (uint32_t m = grp.match(tag); m; m &= m - 1) {
+                size_t idx = base + lowest_bit(m);
+                if (eq_(slots_[idx].first, k)) return idx;
+            }
+            if (grp.match_empty()) return npos;
+        }
+        return npos;
+    }
+
+    // After an erase: shrink below shrink_load_, or purge once tombstones
+    // fill a quarter of the table and outnumber the elements. Tables are
+    // powers of two, so a shrink needs a target of at most half the capacity.
+    void after_erase() {
+        if (size_ < capacity_ * shrink_load_ && shrink_capacity(size_, max_load_) <= capacity_ / 2) {
+            rehash(shrink_capacity(size_, max_load_));
+            return;
+        }
+        if (deleted_count_ > capacity_ / 4 && deleted_count_ > size_) purge_tombstones();
+    }
+
+    // Keys are unique in the old table, so elements are moved into the first
+    // free slot of their probe sequence without any key comparisons.
+    void rehash(size_t new_cap) {
+        OpStats::Rehash timer(op_stats_);
+        auto old_ctrl = std::move(ctrl_);
+        auto old_slots = std::move(slots_);
+        allocate(new_cap);
+        deleted_count_ = 0;
+        for (size_t i = 0; i < old_ctrl.size(); ++i) {
+            if (old_ctrl[i] < 0) continue;
+            uint64_t h = full_hash(old_slots[i].first);
+            size_t g = home_group(h);
+            for (size_t probe = 0;; g = (g + ++probe) & group_mask_) {
+                size_t base = g * group_width;
+                uint32_t free = CtrlGroup(&ctrl_[base]).match_free();
+                if (free) {
+                    size_t idx = base + lowest_bit(free);
+                    ctrl_[idx] = tag_of(h);
+                    slots_[idx] = std::move(old_slots[i]);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+
+// -----------------------------
+// Robin Hood hashing: linear probing where every slot records its probe
+// sequence length (psl, 1-based, 0 = empty). An insert takes the slot of any
+// element that is closer to its home than the new one ("rich" element), which
+// keeps probe lengths tightly clustered around the mean. Erase shifts the
+// following elements back by one instead of leaving a tombstone, so churn never
+// degrades the table.
+// -----------------------------
+template <typename Key, typename Value>
+struct RobinHoodSlot {
+    uint32_t psl;
+    Key key;
+    Value value;
+    RobinHoodSlot() : psl(0), key(), value() {}
+};
+
+template <
+    typename Key,
+    typename Value,
+    typename HashPolicy = DivisionHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename CapacityPolicy = PrimeCapacity,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class RobinHoodHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hash_policy = HashPolicy;
+    using capacity_policy = CapacityPolicy;
+    using allocator_type = Allocator;
+
+    // Robin Hood keeps probes short up to high load, hence the larger default.
+    explicit RobinHoodHashMap(size_t initial_capacity = 16, double max_load = 0.85,
+                              const Allocator& alloc = Allocator())
+        : policy_(), eq_(), table_(alloc), size_(0), max_load_(std::min(max_load, 0.95)) {
+        capacity_ = cap_.round_up(initial_capacity);
+        cap_.reset(capacity_);
+        table_.resize(capacity_);
+    }
+
+    bool insert(const Key& k, const Value& v) { return emplace_impl(k, true, v); }
+    bool insert(Key&& k, Value&& v) { return emplace_impl(std::move(k), true, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...); }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    const Value* find_ptr(const Key& k) const { return value_ptr(locate(k)); }
+    Value* find_ptr(const Key& k) { return value_ptr(locate(k)); }
+
+    bool contains(const Key& k) const { return locate(k) != npos; }
+
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    Value* find_ptr(const K& k) { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return locate(k) != npos; }
+
+    bool erase(const Key& k) {
+        size_t idx = locate(k);
+        if (idx == npos) return false;
+        // backward shift: pull the rest of the cluster one slot closer to home
+        for (size_t next = cap_.wrap(idx + 1); table_[next].psl > 1; next = cap_.wrap(next + 1)) {
+            table_[idx] = std::move(table_[next]);
+            --table_[idx].psl;
+            idx = next;
+        }
+        table_[idx].psl = 0;
+        --size_;
+        after_erase();
+        return true;
+    }
+
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return capacity_; }
+    void clear() noexcept {
+        table_.clear();
+        table_.resize(capacity_);
+        size_ = 0;
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const auto& slot : table_)
+            if (slot.psl != 0) f(slot.key, slot.value);
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        for (auto& slot : table_)
+            if (slot.psl != 0) f(std::as_const(slot.key), slot.value);
+    }
+
+    // Load and clustering (longest run of non-empty slots), plus the
+    // HASHING_STATS counters.
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size_, capacity_, 0,
+                       longest_run(capacity_, [this](size_t i) { return table_[i].psl != 0; }));
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return allocator_type(table_.get_allocator()); }
+
+    void set_shrink_load(double min_load) {
+        check_shrink_load(min_load, max_load_);
+        shrink_load_ = min_load;
+    }
+
+    void shrink_to_fit() { rehash(static_cast<size_t>(size_ / max_load_) + 1); }
+
+    void reserve(size_t n) {
+        size_t want = cap_.round_up(static_cast<size_t>(n / max_load_) + 1);
+        if (want > capacity_) rehash(want);
+    }
+
+    // Parallel bulk load, as in LinearProbingHashMap: items are partitioned
+    // (stably, see BulkPartition) by the region of their home slot and each
+    // worker fills its own regions with no locking. An insert whose lookup or
+    // displacement would run past its region's end is deferred untouched and
+    // finished serially afterwards. Runs only grow during the build, so once
+    // one copy of a key is deferred the later ones are too and dedup follows
+    // input order exactly as documented for DedupPolicy.
+    void bulk_build(const std::vector<std::pair<Key,Value>>& items,
+                    DedupPolicy dedup = DedupPolicy::LastWins, size_t threads = 0) {
+        const bool assign = dedup == DedupPolicy::LastWins;
+        const size_t n = items.size();
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        reserve(size_ + n);
+        if (threads == 1 || n < 4 * kBulkRegion) {
+            for (const auto& kv : items) emplace_impl(kv.first, assign, kv.second);
+            return;
+        }
+
+        // 1. partition by region of the home slot
+        const size_t regions = std::max<size_t>(1, std::min(capacity_ / kBulkRegion, threads * 16));
+        BulkPartition part(n, regions, capacity_, threads, [&](size_t i) { return home(items[i].first); },
+                           [](size_t h) { return h; });
+
+        // 2. fill regions independently; an insert needs an empty slot before
+        //    the region's end, or it waits in `deferred`
+        std::vector<std::vector<size_t>> deferred(regions);
+        std::vector<size_t> added(regions, 0);
+        parallel_for(regions, threads, [&](size_t r) {
+            size_t end = part.end(r);
+            for (size_t pos = part.begin[r]; pos < part.begin[r + 1]; ++pos) {
+                size_t i = part.order[pos];
+                size_t idx = part.hcs[i];
+                uint32_t psl = 1;
+                for (; idx < end; ++idx, ++psl) {
+                    const auto& slot = table_[idx];
+                    if (slot.psl < psl) break;
+                    if (slot.psl == psl && eq_(slot.key, items[i].first)) break;
+                }
+                if (idx < end && table_[idx].psl == psl) { // found
+                    if (assign) table_[idx].value = items[i].second;
+                    continue;
+                }
+                size_t free = idx;
+                while (free < end && table_[free].psl != 0) ++free;
+                if (free == end) {
+                    deferred[r].push_back(i);
+                    continue;
+                }
+                RobinHoodSlot<Key,Value> cur;
+                cur.psl = psl;
+                cur.key = items[i].first;
+                cur.value = items[i].second;
+                place(std::move(cur), idx); // stops at free
+                ++added[r];
+            }
+        });
+        for (size_t a : added) size_ += a;
+
+        // 3. stragglers, serially and in input order per key
+        for (size_t r = 0; r < regions; ++r)
+            for (size_t i : deferred[r]) emplace_impl(items[i].first, assign, items[i].second);
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
+        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
+        std::vector<std::pair<Key,Value>> tmp = items;
+        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
+        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+        for (auto &kv : tmp) insert(kv.first, kv.second);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t kBulkRegion = 4096; // min slots per bulk_build region
+
+    HashPolicy policy_;
+    KeyEqual eq_;
+    CapacityPolicy cap_;
+    size_t capacity_;
+    alloc_vector<RobinHoodSlot<Key,Value>, Allocator> table_;
+    size_t size_;
+    double max_load_;
+    double shrink_load_ = 0;
+    OpStats op_stats_;
+
+    template <typename K>
+    size_t home(const K& k) const { return cap_.index(policy_(k, cap_.modulus())); }
+
+    const Value* value_ptr(size_t idx) const { return idx == npos ? nullptr : &table_[idx].value; }
+    Value* value_ptr(size_t idx) { return idx == npos ? nullptr : &table_[idx].value; }
+
+    template <typename K>
+    size_t locate(const K& k) const {
+        size_t idx = home(k);
+        OpStats::Probe probes(op_stats_);
+        for (uint32_t psl = 1;; ++psl, idx = cap_.wrap(idx + 1)) {
+            probes.step();
+            const auto &slot = table_[idx];
+            if (slot.psl < psl) return npos; // k would have displaced this element
+            if (slot.psl == psl && eq_(slot.key, k)) return idx;
+        }
+    }
+
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        if ((size_ + 1) > static_cast<size_t>(capacity_ * max_load_))
+            rehash(capacity_ * 2);
+
+        size_t idx = home(k);
+        uint32_t psl = 1;
+        OpStats::Probe probes(op_stats_);
+        // lookup phase: an empty slot or a richer element proves k is absent
+        for (;; ++psl, idx = cap_.wrap(idx + 1)) {
+            probes.step();
+            auto &slot = table_[idx];
+            if (slot.psl < psl) break;
+            if (slot.psl == psl && eq_(slot.key, k)) {
+                if (assign) assign_from(slot.value, std::forward<Args>(args)...); // update
+                return false;
+            }
+        }
+        RobinHoodSlot<Key,Value> cur;
+        cur.psl = psl;
+        cur.key = std::forward<K>(k);
+        assign_from(cur.value, std::forward<Args>(args)...);
+        place(std::move(cur), idx);
+        ++size_;
+        return true;
+    }
+
+    // Robin Hood displacement starting at idx with cur.psl already set for that
+    // slot; cur is known not to be in the table.
+    void place(RobinHoodSlot<Key,Value>&& cur, size_t idx) {
+        for (;; ++cur.psl, idx = cap_.wrap(idx + 1)) {
+            auto &slot = table_[idx];
+            if (slot.psl == 0) {
+                slot = std::move(cur);
+                return;
+            }
+            if (slot.psl < cur.psl) std::swap(slot, cur);
+        }
+    }
+
+    // After an erase: shrink once the load is below shrink_load_.
+    void after_erase() {
+        if (size_ < capacity_ * shrink_load_) {
+            size_t want = cap_.round_up(shrink_capacity(size_, max_load_));
+            if (want < capacity_) rehash(want);
+        }
+    }
+
+    void rehash(size_t new_cap) {
+        OpStats::Rehash timer(op_stats_);
+        new_cap = cap_.round_up(new_cap);
+        auto old = std::move(table_);
+        table_.clear();
+        table_.resize(new_cap);
+        capacity_ = new_cap;
+        cap_.reset(capacity_);
+        for (auto &slot : old) {
+            if (slot.psl == 0) continue;
+            size_t idx = home(slot.key);
+            slot.psl = 1;
+            place(std::move(slot), idx);
+        }
+    }
+};
+
+
+// -----------------------------
+// Hopscotch hashing: every element lives within kNeighborhood (64) slots of its
+// home slot, and the home slot keeps a bitmap of which of those slots hold its
+// elements. A lookup reads one bitmap and compares only the keys it marks
+// (almost always within a cache line or two of home, even at 90% load);
+// misses need no probe sequence. An insert takes the nearest free slot and,
+// while that is outside the neighborhood, hops it back by moving an element
+// that may legally take it; if no such element exists the table grows. On
+// large tables a 32-slot neighborhood overflows at around 80% load, a 64-slot
+// one only near 90%. Below half of max_load an overflow means patterned keys
+// or a weak hash policy (MidSquareHash sends every key below 256 home to slot
+// 0), which growing cannot fix: such keys go to a small overflow stash
+// instead, chained per home slot so a lookup only compares the stashed keys
+// that share its home. No tombstones.
+// -----------------------------
+template <typename Key, typename Value>
+struct HopscotchSlot {
+    uint64_t hop; // bit i: slot home+i holds an element whose home is this slot
+    bool used;
+    uint32_t stash; // 1 + index of the first stashed key with this home, 0 if none
+    Key key;
+    Value value;
+    HopscotchSlot() : hop(0), used(false), stash(0), key(), value() {}
+};
+
+template <
+    typename Key,
+    typename Value,
+    typename HashPolicy = DivisionHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename CapacityPolicy = PrimeCapacity,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class HopscotchHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hash_policy = HashPolicy;
+    using capacity_policy = CapacityPolicy;
+    using allocator_type = Allocator;
+
+    static constexpr size_t kNeighborhood = 64;
+
+    explicit HopscotchHashMap(size_t initial_capacity = 32, double max_load = 0.9,
+                              const Allocator& alloc = Allocator())
+        : policy_(), eq_(), table_(alloc), stash_(alloc), size_(0), max_load_(std::min(max_load, 0.97)) {
+        capacity_ = cap_.round_up(std::max(initial_capacity, kNeighborhood));
+        cap_.reset(capacity_);
+        table_.resize(capacity_);
+    }
+
+    bool insert(const Key& k, const Value& v) { return emplace_impl(k, true, v); }
+    bool insert(Key&& k, Value&& v) { return emplace_impl(std::move(k), true, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(Key&& k, Args&&... args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...); }
+
+    std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    const Value* find_ptr(const Key& k) const { return lookup(k); }
+    Value* find_ptr(const Key& k) { return const_cast<Value*>(lookup(k)); }
+
+    bool contains(const Key& k) const { return lookup(k) != nullptr; }
+
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return lookup(k); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    Value* find_ptr(const K& k) { return const_cast<Value*>(lookup(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return lookup(k) != nullptr; }
+
+    bool erase(const Key& k) {
+        size_t h = home(k);
+        size_t idx = locate(k, h);
+        if (idx != npos) {
+            size_t offset = idx >= h ? idx - h : idx + capacity_ - h;
+            table_[h].hop &= ~(uint64_t(1) << offset);
+            table_[idx].used = false;
+        } else if (!unstash(k, h)) {
+            return false;
+        }
+        --size_;
+        after_erase();
+        return true;
+    }
+
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return capacity_; }
+    void clear() noexcept {
+        table_.clear();
+        table_.resize(capacity_);
+        stash_.clear();
+        size_ = 0;
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const auto& slot : table_)
+            if (slot.used) f(slot.key, slot.value);
+        for (const auto& e : stash_) f(e.key, e.value);
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        for (auto& slot : table_)
+            if (slot.used) f(std::as_const(slot.key), slot.value);
+        for (auto& e : stash_) f(std::as_const(e.key), e.value);
+    }
+
+    // Elements kept in the overflow stash.
+    size_t stash_size() const noexcept { return stash_.size(); }
+
+    // Load and clustering (longest run of used slots), plus the HASHING_STATS
+    // counters (one probe for the bitmap plus one per key compared).
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size_, capacity_, 0,
+                       longest_run(capacity_, [this](size_t i) { return table_[i].used; }));
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    allocator_type get_allocator() const { return allocator_type(table_.get_allocator()); }
+
+    void set_shrink_load(double min_load) {
+        check_shrink_load(min_load, max_load_);
+        shrink_load_ = min_load;
+    }
+
+    void shrink_to_fit() { rehash(static_cast<size_t>(size_ / max_load_) + 1); }
+
+    void reserve(size_t n) {
+        size_t want = cap_.round_up(static_cast<size_t>(n / max_load_) + 1);
+        if (want > capacity_) rehash(want);
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
+        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
+        std::vector<std::pair<Key,Value>> tmp = items;
+        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
+        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
+        for (auto &kv : tmp) insert(kv.first, kv.second);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t kMaxScan = 1024; // farthest free slot worth hopping back
+
+    HashPolicy policy_;
+    KeyEqual eq_;
+    CapacityPolicy cap_;
+    size_t capacity_;
+    alloc_vector<HopscotchSlot<Key,Value>, Allocator> table_;
+    struct StashEntry {
+        Key key;
+        Value value;
+        uint32_t next; // 1 + index of the next stashed key with the same home, 0 if last
+    };
+    alloc_vector<StashEntry, Allocator> stash_; // neighborhood overflow at low load
+    size_t size_;
+    double max_load_;
+    double shrink_load_ = 0;
+    OpStats op_stats_;
+
+    template <typename K>
+    size_t home(const K& k) const { return cap_.index(policy_(k, cap_.modulus())); }
+
+    template <typename K>
+    const Value* lookup(const K& k) const {
+        size_t h = home(k);
+        size_t idx = locate(k, h);
+        if (idx != npos) return &table_[idx].value;
+        return stash_find(k, h);
+    }
+
+    template <typename K>
+    const Value* stash_find(const K& k, size_t h) const {
+        OpStats::Probe probes(op_stats_);
+        for (uint32_t i = table_[h].stash; i; i = stash_[i - 1].next) {
+            probes.step();
+            if (eq_(stash_[i - 1].key, k)) return &stash_[i - 1].value;
+        }
+        return nullptr;
+    }
+
+    // Unlinks k from h's stash chain; the last entry fills the hole, so the
+    // link to it is redirected.
+    bool unstash(const Key& k, size_t h) {
+        uint32_t* link = &table_[h].stash;
+        while (*link && !eq_(stash_[*link - 1].key, k)) link = &stash_[*link - 1].next;
+        if (!*link) return false;
+        uint32_t i = *link;
+        *link = stash_[i - 1].next;
+        uint32_t last = static_cast<uint32_t>(stash_.size());
+        if (i != last) {
+            link = &table_[home(stash_[last - 1].key)].stash;
+            while (*link != last) link = &stash_[*link - 1].next;
+            *link = i;
+            stash_[i - 1] = std::move(stash_[last - 1]);
+        }
+        stash_.pop_back();
+        return true;
+    }
+
+    // A full neighborhood is only worth growing for once the table is half
+    // way to max_load_; below that the key goes to the stash.
+    bool overflow_grows() const noexcept { return size_ >= capacity_ * max_load_ / 2; }
+
+    // Stores k in its neighborhood, growing or stashing when that is full.
+    template <typename K, typename... Args>
+    void place(K&& k, size_t h, Args&&... args) {
+        size_t idx, offset;
+        while ((idx = claim(h, offset)) == npos) {
+            if (!overflow_grows()) {
+                stash_.push_back(StashEntry{std::forward<K>(k), Value(std::forward<Args>(args)...), table_[h].stash});
+                table_[h].stash = static_cast<uint32_t>(stash_.size());
+                return;
+            }
+            rehash(capacity_ * 2);
+            h = home(k);
+        }
+        table_[idx].key = std::forward<K>(k);
+        assign_from(table_[idx].value, std::forward<Args>(args)...);
+        table_[idx].used = true;
+        table_[h].hop |= uint64_t(1) << offset;
+    }
+
+    template <typename K>
+    size_t locate(const K& k, size_t h) const {
+        OpStats::Probe probes(op_stats_);
+        probes.step();
+        for (uint64_t bits = table_[h].hop; bits; bits &= bits - 1) {
+            probes.step();
+            size_t idx = cap_.wrap(h + lowest_bit(bits));
+            if (eq_(table_[idx].key, k)) return idx;
+        }
+        return npos;
+    }
+
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        size_t h = home(k);
+        size_t idx = locate(k, h);
+        const Value* v = idx != npos ? &table_[idx].value : stash_find(k, h);
+        if (v) {
+            if (assign) assign_from(*const_cast<Value*>(v), std::forward<Args>(args)...); // update
+            return false;
+        }
+        if ((size_ + 1) > static_cast<size_t>(capacity_ * max_load_)) {
+            rehash(capacity_ * 2);
+            h = home(k);
+        }
+        place(std::forward<K>(k), h, std::forward<Args>(args)...);
+        ++size_;
+        return true;
+    }
+
+    // A free slot within h's neighborhood (offset from h returned in offset),
+    // hopping the nearest free slot back as needed; npos if that fails.
+    size_t claim(size_t h, size_t& offset) {
+        size_t limit = std::min(capacity_, kMaxScan);
+        size_t d = 0;
+        while (d < limit && table_[cap_.wrap(h + d)].used) ++d;
+        if (d == limit) return npos;
+        size_t free = cap_.wrap(h + d);
+        while (d >= kNeighborhood) {
+            // the earliest element in the kNeighborhood-1 slots before `free`
+            // whose own home is close enough to move into it
+            bool moved = false;
+            for (size_t t = kNeighborhood - 1; t > 0 && !moved; --t) {
+                size_t b = cap_.wrap(free + capacity_ - t);
+                uint64_t bits = table_[b].hop & ((uint64_t(1) << t) - 1);
+                if (!bits) continue;
+                unsigned i = lowest_bit(bits);
+                size_t j = cap_.wrap(b + i);
+                table_[free].key = std::move(table_[j].key);
+                table_[free].value = std::move(table_[j].value);
+                table_[free].used = true;
+                table_[j].used = false;
+                table_[b].hop = (table_[b].hop & ~(uint64_t(1) << i)) | (uint64_t(1) << t);
+                free = j;
+                d -= t - i;
+                moved = true;
+            }
+            if (!moved) return npos;
+        }
+        offset = d;
+        return free;
+    }
+
+    // After an erase: shrink once the load is below shrink_load_.
+    void after_erase() {
+        if (size_ < capacity_ * shrink_load_) {
+            size_t want = cap_.round_up(std::max(shrink_capacity(size_, max_load_), kNeighborhood));
+            if (want < capacity_) rehash(want);
+        }
+    }
+
+    // Moves every element, stashed ones included, into a table of new_cap
+    // slots; grows further or stashes if a neighborhood overflows on the way.
+    void rehash(size_t new_cap) {
+        OpStats::Rehash timer(op_stats_);
+        auto old = std::move(table_);
+        auto old_stash = std::move(stash_);
+        stash_.clear();
+        capacity_ = cap_.round_up(std::max(new_cap, kNeighborhood));
+        cap_.reset(capacity_);
+        table_.clear();
+        table_.resize(capacity_);
+        for (auto& slot : old)
+            if (slot.used) place(std::move(slot.key), home(slot.key), std::move(slot.value));
+        for (auto& e : old_stash) place(std::move(e.key), home(e.key), std::move(e.value));
+    }
+};
+
+// -----------------------------
+// Concurrent map: keys are spread over a power-of-two number of shards, each
+// a LinearProbingHashMap behind its own reader-writer lock, so threads only
+// contend when they hit the same shard. The shard is picked from the high
+// bits of the mixed hash, leaving the low bits for the index inside a shard.
+// Lookups return copies (or run a visitor under the read lock): a pointer
+// into a shard would outlive the lock.
+// -----------------------------
+template <
+    typename Key,
+    typename Value,
+    typename HashPolicy = DivisionHash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename CapacityPolicy = PrimeCapacity,
+    typename Layout = AoSLayout,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class ConcurrentHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hash_policy = HashPolicy;
+    using allocator_type = Allocator;
+    using shard_type = LinearProbingHashMap<Key, Value, HashPolicy, KeyEqual, CapacityPolicy, Layout, Allocator>;
+
+    // shards == 0 picks 4 per hardware thread; initial_capacity is the total.
+    // Every shard allocates its table from alloc.
+    explicit ConcurrentHashMap(size_t shards = 0, size_t initial_capacity = 16, double max_load = 0.6,
+                               const Allocator& alloc = Allocator()) {
+        if (shards == 0) shards = 4 * std::max(1u, std::thread::hardware_concurrency());
+        num_shards_ = next_pow2(shards);
+        shard_mask_ = num_shards_ - 1;
+        size_t per_shard = std::max<size_t>(initial_capacity / num_shards_, 8);
+        shards_.reserve(num_shards_);
+        for (size_t i = 0; i < num_shards_; ++i) shards_.push_back(std::make_unique<Shard>(per_shard, max_load, alloc));
+    }
+
+    bool insert(const Key& k, const Value& v) {
+        Shard& s = shard(k);
+        std::unique_lock<std::shared_mutex> lock(s.mu);
+        return s.map.insert(k, v);
+    }
+    bool insert(Key&& k, Value&& v) {
+        Shard& s = shard(k);
+        std::unique_lock<std::shared_mutex> lock(s.mu);
+        return s.map.insert(std::move(k), std::move(v));
+    }
+
+    template <typename... Args>
+    bool emplace(const Key& k, Args&&... args) {
+        Shard& s = shard(k);
+        std::unique_lock<std::shared_mutex> lock(s.mu);
+        return s.map.emplace(k, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    bool try_emplace(const Key& k, Args&&... args) {
+        Shard& s = shard(k);
+        std::unique_lock<std::shared_mutex> lock(s.mu);
+        return s.map.try_emplace(k, std::forward<Args>(args)...);
+    }
+
+    bool erase(const Key& k) {
+        Shard& s = shard(k);
+        std::unique_lock<std::shared_mutex> lock(s.mu);
+        return s.map.erase(k);
+    }
+
+    std::optional<Value> find(const Key& k) const { return find_impl(k); }
+    bool contains(const Key& k) const { return contains_impl(k); }
+
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    std::optional<Value> find(const K& k) const { return find_impl(k); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return contains_impl(k); }
+
+    // Calls f(const Value&) under the shard's read lock; false if k is absent.
+    template <typename F>
+    bool visit(const Key& k, F&& f) const {
+        const Shard& s = shard(k);
+        std::shared_lock<std::shared_mutex> lock(s.mu);
+        const Value* v = s.map.find_ptr(k);
+        if (!v) return false;
+        f(*v);
+        return true;
+    }
+
+    // Sum over shards; only a snapshot while writers are running.
+    size_t size() const {
+        size_t n = 0;
+        for (size_t i = 0; i < num_shards_; ++i) {
+            std::shared_lock<std::shared_mutex> lock(shards_[i]->mu);
+            n += shards_[i]->map.size();
+        }
+        return n;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < num_shards_; ++i) {
+            std::unique_lock<std::shared_mutex> lock(shards_[i]->mu);
+            shards_[i]->map.clear();
+        }
+    }
+
+    size_t shard_count() const noexcept { return num_shards_; }
+    allocator_type get_allocator() const { return shards_[0]->map.get_allocator(); }
+
+    // Room for n elements in total: each shard reserves its even share plus
+    // an eighth for skew.
+    void reserve(size_t n) {
+        size_t per_shard = n / num_shards_ + n / num_shards_ / 8 + 1;
+        for_each_shard_locked([per_shard](shard_type& m) { m.reserve(per_shard); });
+    }
+    void shrink_to_fit() { for_each_shard_locked([](shard_type& m) { m.shrink_to_fit(); }); }
+    void purge_tombstones() { for_each_shard_locked([](shard_type& m) { m.purge_tombstones(); }); }
+    // Auto-shrink per shard, see LinearProbingHashMap::set_shrink_load.
+    void set_shrink_load(double min_load) {
+        for_each_shard_locked([min_load](shard_type& m) { m.set_shrink_load(min_load); });
+    }
+
+    // Shard stats summed (counts) or maxed (longest chain, max probe), each
+    // shard read under its lock; only a snapshot while writers are running.
+    HashMapStats stats() const {
+        HashMapStats total;
+        for (size_t i = 0; i < num_shards_; ++i) {
+            HashMapStats s;
+            {
+                std::shared_lock<std::shared_mutex> lock(shards_[i]->mu);
+                s = shards_[i]->map.stats();
+            }
+            total.size += s.size;
+            total.capacity += s.capacity;
+            total.tombstones += s.tombstones;
+            total.longest_chain = std::max(total.longest_chain, s.longest_chain);
+            total.operations += s.operations;
+            total.probes += s.probes;
+            total.max_probe = std::max(total.max_probe, s.max_probe);
+            for (size_t b = 0; b < HashMapStats::kHistogramSize; ++b) total.probe_histogram[b] += s.probe_histogram[b];
+            total.rehashes += s.rehashes;
+            total.rehash_seconds += s.rehash_seconds;
+        }
+        fill_structure(total, total.size, total.capacity, total.tombstones, total.longest_chain);
+        return total;
+    }
+    void reset_stats() {
+        for (size_t i = 0; i < num_shards_; ++i) {
+            std::unique_lock<std::shared_mutex> lock(shards_[i]->mu);
+            shards_[i]->map.reset_stats();
+        }
+    }
+
+    // Calls f(const shard_type&) for every shard under its read lock, handing
+    // shards out to up to `threads` workers (0 = one per hardware thread);
+    // f must be safe to call concurrently and must not throw.
+    template <typename F>
+    void for_each_shard(F&& f, size_t threads = 0) const {
+        parallel_for(num_shards_, threads, [&](size_t i) {
+            std::shared_lock<std::shared_mutex> lock(shards_[i]->mu);
+            f(static_cast<const shard_type&>(shards_[i]->map));
+        });
+    }
+
+    // Parallel bulk load: items are partitioned by shard (stable, so input
+    // order is kept per key) and each worker fills whole shards, presizing
+    // them first.
+    void bulk_build(const std::vector<std::pair<Key,Value>>& items,
+                    DedupPolicy dedup = DedupPolicy::LastWins, size_t threads = 0) {
+        std::vector<std::vector<size_t>> parts(num_shards_);
+        for (size_t i = 0; i < items.size(); ++i)
+            parts[shard_index(items[i].first)].push_back(i);
+        parallel_for(num_shards_, threads, [&](size_t s) {
+            std::unique_lock<std::shared_mutex> lock(shards_[s]->mu);
+            shard_type& m = shards_[s]->map;
+            m.reserve(m.size() + parts[s].size());
+            for (size_t i : parts[s]) {
+                if (dedup == DedupPolicy::LastWins) m.insert(items[i].first, items[i].second);
+                else m.try_emplace(items[i].first, items[i].second);
+            }
+        });
+    }
+
+    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup = false) {
+        (void)dedup; // insert() assigns, so later duplicates win either way
+        for (const auto& kv : items) insert(kv.first, kv.second);
+    }
+
+private:
+    // one cache line per lock so neighbouring shards do not false-share
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mu;
+        shard_type map;
+        Shard(size_t capacity, double max_load, const Allocator& alloc) : map(capacity, max_load, alloc) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t num_shards_;
+    size_t shard_mask_;
+    HashPolicy policy_;
+
+    template <typename K>
+    size_t shard_index(const K& k) const { return (mix64(policy_(k, kHashRange)) >> 32) & shard_mask_; }
+    template <typename K>
+    const Shard& shard(const K& k) const { return *shards_[shard_index(k)]; }
+    template <typename K>
+    Shard& shard(const K& k) { return *shards_[shard_index(k)]; }
+
+    // f(shard_type&) on each shard in turn, under its write lock
+    template <typename F>
+    void for_each_shard_locked(F&& f) {
+        for (size_t i = 0; i < num_shards_; ++i) {
+            std::unique_lock<std::shared_mutex> lock(shards_[i]->mu);
+            f(shards_[i]->map);
+        }
+    }
+
+    template <typename K>
+    std::optional<Value> find_impl(const K& k) const {
+        const Shard& s = shard(k);
+        std::shared_lock<std::shared_mutex> lock(s.mu);
+        const Value* v = s.map.find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+    template <typename K>
+    bool contains_impl(const K& k) const {
+        const Shard& s = shard(k);
+        std::shared_lock<std::shared_mutex> lock(s.mu);
+        return s.map.contains(k);
+    }
+};
+
+// -----------------------------
+// Slab pool: fixed-size cells carved out of geometrically growing slabs, with
+// an intrusive free list for reuse. Allocation is a pointer pop, and nodes of
+// one container stay packed together instead of scattered over the heap.
+// Objects still alive when the pool dies are not destroyed. Slabs come from
+// Alloc; like a std container, swapping pools requires equal allocators.
+// -----------------------------
+template <typename T, typename Alloc = std::allocator<T>>
+class SlabPool {
+    union Cell;
+public:
+    explicit SlabPool(size_t first_slab = 16, const Alloc& alloc = Alloc())
+        : slabs_(alloc), next_slab_(std::max<size_t>(first_slab, 1)) {}
+    SlabPool(SlabPool&& other) noexcept : slabs_(other.slabs_.get_allocator()), next_slab_(other.next_slab_) {
+        swap(other);
+    }
+    SlabPool& operator=(SlabPool&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    void swap(SlabPool& other) noexcept {
+        using std::swap;
+        swap(slabs_, other.slabs_);
+        swap(free_, other.free_);
+        swap(used_, other.used_);
+        swap(slab_size_, other.slab_size_);
+        swap(next_slab_, other.next_slab_);
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        Cell* c = allocate();
+        try {
+            return ::new (static_cast<void*>(c->storage)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            release(c);
+            throw;
+        }
+    }
+
+    void destroy(T* p) noexcept {
+        p->~T();
+        release(reinterpret_cast<Cell*>(p));
+    }
+
+    // n cells in a slab of their own, for building objects from several
+    // threads: create_at(block, i, ...) may run concurrently for distinct i,
+    // and release_at(block, i), which may not, returns a cell left unused.
+    Cell* allocate_block(size_t n) {
+        cell_alloc a(slabs_.get_allocator());
+        slabs_.reserve(slabs_.size() + 1);
+        Cell* cells = std::allocator_traits<cell_alloc>::allocate(a, n);
+        // ahead of the slab allocate() is carving up, which stays last
+        slabs_.insert(slabs_.end() - (slabs_.empty() ? 0 : 1), Slab{cells, n});
+        return cells;
+    }
+    template <typename... Args>
+    static T* create_at(Cell* block, size_t i, Args&&... args) {
+        return ::new (static_cast<void*>(block[i].storage)) T(std::forward<Args>(args)...);
+    }
+    void release_at(Cell* block, size_t i) noexcept { release(&block[i]); }
+
+    ~SlabPool() {
+        cell_alloc a(slabs_.get_allocator());
+        for (const Slab& slab : slabs_) std::allocator_traits<cell_alloc>::deallocate(a, slab.cells, slab.size);
+    }
+
+private:
+    union Cell {
+        Cell* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+    struct Slab {
+        Cell* cells;
+        size_t size;
+    };
+    using cell_alloc = rebind_alloc_t<Alloc, Cell>;
+    static constexpr size_t kMaxSlab = 4096;
+
+    alloc_vector<Slab, Alloc> slabs_;
+    Cell* free_ = nullptr;
+    size_t used_ = 0;  // cells handed out from slabs_.back()
+    size_t slab_size_ = 0;
+    size_t next_slab_;
+
+    Cell* allocate() {
+        if (free_) {
+            Cell* c = free_;
+            free_ = c->next;
+            return c;
+        }
+        if (used_ == slab_size_) {
+            cell_alloc a(slabs_.get_allocator());
+            slabs_.reserve(slabs_.size() + 1); // so push_back cannot throw and leak the slab
+            slabs_.push_back(Slab{std::allocator_traits<cell_alloc>::allocate(a, next_slab_), next_slab_});
+            slab_size_ = next_slab_;
+            next_slab_ = std::min(next_slab_ * 2, kMaxSlab);
+            used_ = 0;
+        }
+        return &slabs_.back().cells[used_++];
+    }
+
+    void release(Cell* c) noexcept {
+        c->next = free_;
+        free_ = c;
+    }
+};
+
+// -----------------------------
+// Separate chaining: each bucket is the head of a singly linked list of
+// nodes drawn from a SlabPool. Lookups are one pass down the chain; rehash
+// relinks the existing nodes, so elements never move or get copied.
+// -----------------------------
+template <
+    typename Key,
+    typename Value,
+    typename H = std::hash<Key>,
+    typename KeyEq = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
+>
+class ChainingHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using hasher = H;
+    using key_equal = KeyEq;
+    using allocator_type = Allocator;
+
+    explicit ChainingHashMap(size_t initial_buckets = 16, double max_load = 0.75,
+                             const Allocator &alloc = Allocator())
+        : hash_(), eq_(), pool_(16, alloc), buckets_(std::max<size_t>(1, initial_buckets), nullptr, alloc),
+          size_(0), max_load_factor_(max_load), old_buckets_(alloc), next_buckets_(alloc)
+    {}
+
+    ChainingHashMap(const ChainingHashMap &other)
+        : ChainingHashMap(other.bucket_count(), other.max_load_factor_,
+                          std::allocator_traits<Allocator>::select_on_container_copy_construction(
+                              other.get_allocator())) {
+        other.for_each([this](const Key &k, const Value &v) { insert(k, v); });
+    }
+    // Leaves other empty with one bucket, so it stays usable.
+    ChainingHashMap(ChainingHashMap &&other)
+        : ChainingHashMap(1, other.max_load_factor_, other.get_allocator()) {
+        swap(other);
+    }
+    ChainingHashMap &operator=(ChainingHashMap other) noexcept {
+        swap(other);
+        return *this;
+    }
+    ~ChainingHashMap() { clear(); }
+
+    void swap(ChainingHashMap &other) noexcept {
+        using std::swap;
+        swap(hash_, other.hash_);
+        swap(eq_, other.eq_);
+        swap(pool_, other.pool_);
+        swap(buckets_, other.buckets_);
+        swap(size_, other.size_);
+        swap(max_load_factor_, other.max_load_factor_);
+        swap(old_buckets_, other.old_buckets_);
+        swap(migrate_pos_, other.migrate_pos_);
+        swap(next_buckets_, other.next_buckets_);
+        swap(next_bucket_count_, other.next_bucket_count_);
+        swap(init_step_, other.init_step_);
+        swap(drain_step_, other.drain_step_);
+        swap(migrate_step_, other.migrate_step_);
+        swap(op_stats_, other.op_stats_);
+    }
+
+    // Insert or update. Returns true if a new element was inserted, false if an existing
+    // element was updated.
+    bool insert(const Key &k, const Value &v) { return emplace_impl(k, true, v).second; }
+    bool insert(Key &&k, Value &&v) { return emplace_impl(std::move(k), true, std::move(v)).second; }
+
+    template <typename... Args>
+    bool emplace(const Key &k, Args &&...args) { return emplace_impl(k, true, std::forward<Args>(args)...).second; }
+    template <typename... Args>
+    bool emplace(Key &&k, Args &&...args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...).second; }
+
+    template <typename... Args>
+    bool try_emplace(const Key &k, Args &&...args) { return emplace_impl(k, false, std::forward<Args>(args)...).second; }
+    template <typename... Args>
+    bool try_emplace(Key &&k, Args &&...args) { return emplace_impl(std::move(k), false, std::forward<Args>(args)...).second; }
+
+    // Remove key; returns true if removed
+    bool erase(const Key &k) {
+        if (rehashing()) rehash_step();
+        OpStats::Probe probes(op_stats_);
+        if (erase_from(buckets_[bucket_index(k)], k, probes)) return true;
+        return !old_buckets_.empty() && erase_from(old_buckets_[old_bucket_index(k)], k, probes);
+    }
+
+    // Returns std::optional<Value> (copy) if found
+    std::optional<Value> find(const Key &k) const {
+        const Value *v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+
+    // Zero-copy lookup: pointer to the stored value or nullptr. Nodes never
+    // move, so the pointer stays valid until the element is erased.
+    const Value *find_ptr(const Key &k) const { return value_ptr(locate(k)); }
+    Value *find_ptr(const Key &k) { return const_cast<Value *>(value_ptr(locate(k))); }
+
+    bool contains(const Key &k) const { return locate(k) != nullptr; }
+
+    // Heterogeneous lookups; need both hasher and key_equal to be transparent
+    // (e.g. StringViewHash + std::equal_to<>)
+    template <typename K, typename = transparent_key_t<K, H, KeyEq>>
+    const Value *find_ptr(const K &k) const { return value_ptr(locate(k)); }
+    template <typename K, typename = transparent_key_t<K, H, KeyEq>>
+    Value *find_ptr(const K &k) { return const_cast<Value *>(value_ptr(locate(k))); }
+    template <typename K, typename = transparent_key_t<K, H, KeyEq>>
+    bool contains(const K &k) const { return locate(k) != nullptr; }
+
+    // operator[]: insert default-constructed value if missing, return reference
+    Value &operator[](const Key &k) { return emplace_impl(k, false).first->second; }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    void clear() noexcept {
+        for (auto *heads : {&buckets_, &old_buckets_}) {
+            for (Node *&head : *heads) {
+                while (head) {
+                    Node *next = head->next;
+                    pool_.destroy(head);
+                    head = next;
+                }
+            }
+        }
+        old_buckets_.clear();
+        next_buckets_.clear();
+        next_bucket_count_ = 0;
+        size_ = 0;
+    }
+
+    template <typename F>
+    void for_each(F &&f) const {
+        for (auto *heads : {&buckets_, &old_buckets_})
+            for (const Node *n : *heads)
+                for (; n; n = n->next) f(n->kv.first, n->kv.second);
+    }
+    template <typename F>
+    void for_each(F &&f) {
+        for (auto *heads : {&buckets_, &old_buckets_})
+            for (Node *n : *heads)
+                for (; n; n = n->next) f(std::as_const(n->kv.first), n->kv.second);
+    }
+
+    size_t bucket_count() const noexcept { return buckets_.size(); }
+    allocator_type get_allocator() const { return allocator_type(buckets_.get_allocator()); }
+
+    double load_factor() const noexcept {
+        return static_cast<double>(size_) / static_cast<double>(bucket_count());
+    }
+
+    double max_load_factor() const noexcept { return max_load_factor_; }
+    void max_load_factor(double lf) {
+        if (!(lf > 0.0)) throw std::invalid_argument("max_load_factor must be > 0");
+        max_load_factor_ = lf;
+    }
+
+    // Load per bucket and the longest chain (both arrays while migrating), plus
+    // the HASHING_STATS counters (one probe per node visited).
+    HashMapStats stats() const {
+        size_t longest = 0;
+        for (auto *heads : {&buckets_, &old_buckets_}) {
+            for (const Node *n : *heads) {
+                size_t len = 0;
+                for (; n; n = n->next) ++len;
+                longest = std::max(longest, len);
+            }
+        }
+        HashMapStats s;
+        fill_structure(s, size_, bucket_count(), 0, longest);
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept { op_stats_.reset(); }
+
+    // Parallel bulk load. The bucket array is presized once; items are hashed
+    // and partitioned (stably, see BulkPartition) by contiguous bucket range,
+    // and each worker links the nodes of its ranges with no locking. The nodes
+    // come from one pool block, item by item in partition order, so a range's
+    // nodes sit together. Equal keys share a bucket, hence a range, so dedup
+    // follows input order exactly as documented for DedupPolicy.
+    void bulk_build(const std::vector<value_type> &items, DedupPolicy dedup = DedupPolicy::LastWins,
+                    size_t threads = 0) {
+        const bool assign = dedup == DedupPolicy::LastWins;
+        const size_t n = items.size();
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        finish_rehash();
+        reserve(size_ + n);
+        if (threads == 1 || n < 4 * kBulkRange) {
+            for (const auto &kv : items) emplace_impl(kv.first, assign, kv.second);
+            return;
+        }
+
+        // 1. partition by bucket range
+        const size_t bc = bucket_count();
+        const size_t regions = std::max<size_t>(1, std::min(bc / kBulkRange, threads * 16));
+        BulkPartition part(n, regions, bc, threads,
+                           [&](size_t i) { return static_cast<size_t>(hash_(items[i].first)); },
+                           [&](size_t hc) { return hc % bc; });
+
+        // 2. link each range's new nodes; cells of duplicates stay unused
+        auto *block = pool_.allocate_block(n);
+        std::vector<std::vector<size_t>> unused(regions);
+        std::vector<size_t> added(regions, 0);
+        parallel_for(regions, threads, [&](size_t r) {
+            for (size_t pos = part.begin[r]; pos < part.begin[r + 1]; ++pos) {
+                size_t i = part.order[pos];
+                Node *&head = buckets_[part.hcs[i] % bc];
+                Node *node = head;
+                while (node && !eq_(node->kv.first, items[i].first)) node = node->next;
+                if (node) {
+                    if (assign) node->kv.second = items[i].second;
+                    unused[r].push_back(pos);
+                } else {
+                    head = pool_.create_at(block, pos, head, items[i].first, items[i].second);
+                    ++added[r];
+                }
+            }
+        });
+        for (size_t a : added) size_ += a;
+        for (const auto &u : unused)
+            for (size_t pos : u) pool_.release_at(block, pos);
+    }
+
+    // Batch load (vector of pairs) - optionally deduplicate by inserting in order (later inserts overwrite earlier)
+    void batch_load(const std::vector<value_type> &items, bool dedup = false) {
+        if (!dedup) {
+            for (const auto &kv : items) insert(kv.first, kv.second);
+        } else {
+            // simple dedup: insert in sequence (last overwrite previous)
+            for (const auto &kv : items) insert(kv.first, kv.second);
+        }
+    }
+
+    // Incremental rehash (opt-in). With buckets_per_op > 0 growing only
+    // allocates the new bucket array. Each following insert/erase first
+    // clears at least buckets_per_op of its buckets while the current array
+    // keeps serving, then moves at least buckets_per_op old buckets over,
+    // with lookups checking both arrays in the meantime. Both steps are
+    // raised as needed to finish before the next growth is due. 0 (the
+    // default) restores stop-the-world rehashing.
+    void set_incremental_rehash(size_t buckets_per_op) {
+        if (buckets_per_op == 0) finish_rehash();
+        migrate_step_ = buckets_per_op;
+    }
+    bool rehashing() const noexcept { return !old_buckets_.empty() || next_bucket_count_ != 0; }
+    // Completes a pending incremental rehash.
+    void finish_rehash() {
+        if (next_bucket_count_) {
+            next_buckets_.resize(next_bucket_count_, nullptr);
+            start_migration();
+        }
+        migrate(old_buckets_.size());
+    }
+
+    // Buckets for n elements in total without growing.
+    void reserve(size_t n) {
+        size_t want = static_cast<size_t>(n / max_load_factor_) + 1;
+        if (want > bucket_count()) rehash(want);
+    }
+
+    // Fewest buckets that keep the load within max_load_factor. Only the
+    // bucket array shrinks; freed nodes stay in the pool for reuse.
+    void shrink_to_fit() { rehash(static_cast<size_t>(size_ / max_load_factor_) + 1); }
+
+    // Rehash: explicitly change bucket count (will be adjusted to at least 1)
+    void rehash(size_t new_bucket_count) {
+        finish_rehash();
+        OpStats::Rehash timer(op_stats_);
+        new_bucket_count = std::max<size_t>(1, new_bucket_count);
+        alloc_vector<Node *, Allocator> new_buckets(new_bucket_count, nullptr, buckets_.get_allocator());
+
+        // relink nodes; nothing is copied or reallocated
+        for (Node *n : buckets_) {
+            while (n) {
+                Node *next = n->next;
+                Node *&head = new_buckets[static_cast<size_t>(hash_(n->kv.first)) % new_bucket_count];
+                n->next = head;
+                head = n;
+                n = next;
+            }
+        }
+        buckets_.swap(new_buckets);
+    }
+
+private:
+    struct Node {
+        Node *next;
+        value_type kv;
+
+        template <typename K, typename V>
+        Node(Node *nx, K &&k, V &&v) : next(nx), kv(std::forward<K>(k), std::forward<V>(v)) {}
+    };
+
+    static constexpr size_t kBulkRange = 4096; // min buckets per bulk_build range
+
+    hasher hash_;
+    key_equal eq_;
+    SlabPool<Node, rebind_alloc_t<Allocator, Node>> pool_;
+    alloc_vector<Node *, Allocator> buckets_;
+    size_t size_;
+    double max_load_factor_;
+
+    // incremental rehash state: next_bucket_count_ != 0 while the new array is
+    // being cleared, then non-empty old_buckets_ while migrating
+    alloc_vector<Node *, Allocator> old_buckets_;
+    size_t migrate_pos_ = 0;
+    alloc_vector<Node *, Allocator> next_buckets_;
+    size_t next_bucket_count_ = 0;
+    size_t init_step_ = 0;
+    size_t drain_step_ = 0;
+    size_t migrate_step_ = 0;
+    OpStats op_stats_;
+
+    template <typename K>
+    inline size_t bucket_index(const K &k) const {
+        return static_cast<size_t>(hash_(k)) % buckets_.size();
+    }
+    template <typename K>
+    inline size_t old_bucket_index(const K &k) const {
+        return static_cast<size_t>(hash_(k)) % old_buckets_.size();
+    }
+
+    // Returns the element for k and whether it was newly inserted
+    template <typename K, typename... Args>
+    std::pair<value_type *, bool> emplace_impl(K &&k, bool assign, Args &&...args) {
+        if (rehashing()) rehash_step();
+        maybe_rehash_for_insert();
+        if (auto *kv = const_cast<value_type *>(locate(k))) {
+            if (assign) assign_from(kv->second, std::forward<Args>(args)...); // update
+            return {kv, false};
+        }
+
+        // not found -> push a new node at the head of its chain
+        Node *&head = buckets_[bucket_index(k)];
+        head = pool_.create(head, std::forward<K>(k), Value(std::forward<Args>(args)...));
+        ++size_;
+        return {&head->kv, true};
+    }
+
+    template <typename K>
+    const value_type *scan(const Node *n, const K &k, OpStats::Probe &probes) const {
+        for (; n; n = n->next) {
+            probes.step();
+            if (eq_(n->kv.first, k)) return &n->kv;
+        }
+        return nullptr;
+    }
+
+    template <typename K>
+    const value_type *locate(const K &k) const {
+        OpStats::Probe probes(op_stats_);
+        if (const value_type *kv = scan(buckets_[bucket_index(k)], k, probes)) return kv;
+        if (!old_buckets_.empty()) return scan(old_buckets_[old_bucket_index(k)], k, probes);
+        return nullptr;
+    }
+
+    static const Value *value_ptr(const value_type *kv) { return kv ? &kv->second : nullptr; }
+
+    bool erase_from(Node *&head, const Key &k, OpStats::Probe &probes) {
+        for (Node **link = &head; *link; link = &(*link)->next) {
+            probes.step();
+            Node *n = *link;
+            if (eq_(n->kv.first, k)) {
+                *link = n->next;
+                pool_.destroy(n);
+                --size_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves the next n old buckets into the current bucket array.
+    void migrate(size_t n) {
+        for (; n && migrate_pos_ < old_buckets_.size(); --n, ++migrate_pos_) {
+            Node *node = old_buckets_[migrate_pos_];
+            while (node) {
+                Node *next = node->next;
+                Node *&head = buckets_[bucket_index(node->kv.first)];
+                node->next = head;
+                head = node;
+                node = next;
+            }
+            old_buckets_[migrate_pos_] = nullptr;
+        }
+        if (!old_buckets_.empty() && migrate_pos_ == old_buckets_.size()) {
+            alloc_vector<Node *, Allocator>(old_buckets_.get_allocator()).swap(old_buckets_);
+        }
+    }
+
+    // While the next array is cleared the current one runs past
+    // max_load_factor_, to at most 1.5 times it.
+    void maybe_rehash_for_insert() {
+        if (!next_bucket_count_ && load_factor() > max_load_factor_) {
+            // double buckets
+            if (migrate_step_ == 0) {
+                rehash(buckets_.size() * 2);
+                return;
+            }
+            finish_rehash(); // one rebuild at a time
+            OpStats::Rehash timer(op_stats_); // allocation only; the setup and moves are spread out
+            next_bucket_count_ = buckets_.size() * 2;
+            next_buckets_.reserve(next_bucket_count_);
+            size_t room = std::max<size_t>(1, static_cast<size_t>(bucket_count() * max_load_factor_ / 2));
+            init_step_ = std::max(migrate_step_, (next_bucket_count_ + room - 1) / room);
+        }
+    }
+
+    // The bounded share of a pending rehash done by each insert/erase.
+    void rehash_step() {
+        if (next_bucket_count_) {
+            size_t n = std::min(next_bucket_count_, next_buckets_.size() + init_step_);
+            next_buckets_.resize(n, nullptr);
+            if (n == next_bucket_count_) start_migration();
+        } else {
+            migrate(drain_step_);
+        }
+    }
+
+    // Swaps in the cleared next array. The old one must drain before the
+    // new one passes max_load_factor_, hence at least old buckets / headroom
+    // buckets per operation.
+    void start_migration() {
+        old_buckets_.swap(buckets_);
+        buckets_.swap(next_buckets_);
+        next_bucket_count_ = 0;
+        migrate_pos_ = 0;
+        size_t limit = static_cast<size_t>(bucket_count() * max_load_factor_);
+        size_t headroom = limit > size_ ? limit - size_ : 1;
+        drain_step_ = std::max(migrate_step_, (old_buckets_.size() + headroom - 1) / headroom);
+    }
+};
+
+// -----------------------------
+// Compile-time perfect hash map for static key sets (opcodes, header names,
+// enum strings). The constexpr constructor runs hash-and-displace
+// (PTHash-style): keys are split by hash into buckets of about four, and the
+// buckets, largest first, each search a 16-bit pilot that sends all their keys
+// to distinct free slots. A lookup is one hash, one pilot load and one key
+// compare, with no probe loop. Unused slots hold a copy of the first key,
+// which always hashes to its own slot, so they never match a lookup.
+// HashPolicy needs a constexpr seed constructor and constexpr hash64(key).
+// -----------------------------
+template <typename Key>
+using static_hash_t = std::conditional_t<std::is_integral<Key>::value, IntegerMixHash<Key>, Fnv1aHash>;
+
+template <
+    typename Key,
+    typename Value,
+    size_t N,
+    typename HashPolicy = static_hash_t<Key>,
+    typename KeyEqual = std::equal_to<Key>
+>
+class StaticPerfectHashMap {
+    static_assert(N > 0, "StaticPerfectHashMap needs at least one key");
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hash_policy = HashPolicy;
+
+    static constexpr size_t kSlots = next_pow2(N + N / 4 + 1); // load <= 0.8
+    static constexpr size_t kBuckets = (N + 3) / 4;
+
+    // Duplicate keys throw std::invalid_argument, which makes a constexpr
+    // construction ill-formed, i.e. a compile error.
+    constexpr explicit StaticPerfectHashMap(const std::pair<Key,Value> (&items)[N])
+        : policy_(0), eq_(), keys_{}, values_{}, pilots_{} {
+        for (uint64_t seed = 0; seed < kMaxSeeds; ++seed)
+            if (build(items, seed)) return;
+        throw std::logic_error("StaticPerfectHashMap: no perfect hash found");
+    }
+
+    constexpr const Value* find_ptr(const Key& k) const {
+        uint64_t h = policy_.hash64(k);
+        size_t s = slot_of(h, pilots_[bucket_of(h)]);
+        return eq_(keys_[s], k) ? &values_[s] : nullptr;
+    }
+    constexpr std::optional<Value> find(const Key& k) const {
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+    constexpr bool contains(const Key& k) const { return find_ptr(k) != nullptr; }
+
+    static constexpr size_t size() noexcept { return N; }
+
+    // Structure only: lookups are constexpr and cannot record, and there are
+    // no chains, tombstones or rehashes.
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, N, kSlots, 0, 0);
+        return s;
+    }
+
+private:
+    static constexpr uint64_t kMaxSeeds = 64;
+    static constexpr uint32_t kMaxPilot = 65536;
+
+    HashPolicy policy_;
+    KeyEqual eq_;
+    std::array<Key, kSlots> keys_;
+    std::array<Value, kSlots> values_;
+    std::array<uint16_t, kBuckets> pilots_;
 
-    void rehash(size_t new_cap) {
-        new_cap = next_prime(std::max<size_t>(new_cap, 3));
-        auto old = std::move(table_);
-        size_t oldcap = capacity_;
-        capacity_ = new_cap;
-        table_.assign(capacity_, Slot<Key,Value>());
-        size_ = 0; deleted_count_ = 0;
-        for (size_t i = 0; i < oldcap; ++i) if (old[i].state == SlotState::Occupied) insert(old[i].key, old[i].value);
+    static constexpr size_t bucket_of(uint64_t h) noexcept {
+        return static_cast<size_t>(((h >> 32) * kBuckets) >> 32);
+    }
+    static constexpr size_t slot_of(uint64_t h, uint32_t pilot) noexcept {
+        return static_cast<size_t>(mix64(h ^ (pilot * 0x9e3779b97f4a7c15ULL)) & (kSlots - 1));
+    }
+
+    // One attempt with the given seed; false if it needs another seed.
+    constexpr bool build(const std::pair<Key,Value> (&items)[N], uint64_t seed) {
+        policy_ = HashPolicy(seed);
+        std::array<uint64_t, N> h{};
+        std::array<size_t, kBuckets + 1> start{};
+        for (size_t i = 0; i < N; ++i) {
+            h[i] = policy_.hash64(items[i].first);
+            ++start[bucket_of(h[i]) + 1];
+        }
+        for (size_t b = 0; b < kBuckets; ++b) start[b + 1] += start[b];
+        std::array<size_t, N> members{};
+        std::array<size_t, kBuckets> fill{};
+        for (size_t i = 0; i < N; ++i) {
+            size_t b = bucket_of(h[i]);
+            members[start[b] + fill[b]++] = i;
+        }
+
+        // equal full hashes land in one bucket: a duplicate key is an error,
+        // two distinct keys just need another seed
+        size_t largest = 0;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            largest = std::max(largest, fill[b]);
+            for (size_t x = start[b]; x < start[b + 1]; ++x)
+                for (size_t y = x + 1; y < start[b + 1]; ++y)
+                    if (h[members[x]] == h[members[y]]) {
+                        if (eq_(items[members[x]].first, items[members[y]].first))
+                            throw std::invalid_argument("StaticPerfectHashMap: duplicate key");
+                        return false;
+                    }
+        }
+
+        std::array<bool, kSlots> taken{};
+        for (size_t len = largest; len > 0; --len) {
+            for (size_t b = 0; b < kBuckets; ++b) {
+                if (fill[b] != len) continue;
+                uint32_t pilot = 0;
+                while (!fits(h, members, start[b], start[b + 1], taken, pilot))
+                    if (++pilot == kMaxPilot) return false;
+                pilots_[b] = static_cast<uint16_t>(pilot);
+                for (size_t x = start[b]; x < start[b + 1]; ++x) {
+                    size_t i = members[x], s = slot_of(h[i], pilot);
+                    taken[s] = true;
+                    keys_[s] = items[i].first;
+                    values_[s] = items[i].second;
+                }
+            }
+        }
+        for (size_t s = 0; s < kSlots; ++s)
+            if (!taken[s]) keys_[s] = items[0].first;
+        return true;
+    }
+
+    // all keys of members[begin, end) go to distinct free slots under pilot
+    static constexpr bool fits(const std::array<uint64_t, N>& h, const std::array<size_t, N>& members,
+                               size_t begin, size_t end, const std::array<bool, kSlots>& taken, uint32_t pilot) {
+        for (size_t x = begin; x < end; ++x) {
+            size_t s = slot_of(h[members[x]], pilot);
+            if (taken[s]) return false;
+            for (size_t y = begin; y < x; ++y)
+                if (slot_of(h[members[y]], pilot) == s) return false;
+        }
+        return true;
     }
 };
 
+// Deduces N from a braced list:
+//   constexpr auto ops = make_static_map<std::string_view, int>({{"add", 1}, {"sub", 2}});
+template <typename Key, typename Value, typename HashPolicy = static_hash_t<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t N>
+constexpr StaticPerfectHashMap<Key, Value, N, HashPolicy, KeyEqual>
+make_static_map(const std::pair<Key,Value> (&items)[N]) {
+    return StaticPerfectHashMap<Key, Value, N, HashPolicy, KeyEqual>(items);
+}
+
 // -----------------------------
-// Cuckoo hashing (two tables / two hash functions).
-// canonical simple implementation with relocation limit and rehash.
+// Minimal perfect hash map for large read-only key sets (BBHash-style).
+// Level l is a bit array of gamma * (keys still unplaced) bits; every key
+// hashes to one bit per level, and a key that is alone on its bit is placed
+// there while colliding keys retry at the next level. A key's index is the
+// number of set bits before its bit (rank, sampled every 512 bits), so the
+// index costs ~gamma * e^(1/gamma) + 12% bits per key: about 3.7 at the
+// default gamma = 2, about 3.1 at gamma = 1 (more levels, slower lookups).
+// Keys and values sit in dense arrays at that index and the key is compared
+// once, so absent keys are rejected. Keys left after kMaxLevels, including
+// duplicates (which collide on every level), go to a small fallback table;
+// inputs with many duplicates cost extra levels and are best deduped first.
+// Levels are built in parallel with atomic bit sets; no locks.
 // -----------------------------
 template <
     typename Key,
     typename Value,
-    typename Hash1 = DivisionHash<Key>,
-    typename Hash2 = MidSquareHash<Key>,
-    typename KeyEqual = std::equal_to<Key>
+    typename Hasher = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, Value>>
 >
-class CuckooHashMap {
+class MinimalPerfectHashMap {
 public:
-    CuckooHashMap(size_t initial_capacity = 16, double max_load = 0.5, size_t max_kicks = 500)
-        : h1_(), h2_(), eq_(), max_load_(max_load), max_kicks_(max_kicks) {
-        capacity_ = next_prime(std::max<size_t>(initial_capacity, 3));
-        table1_.assign(capacity_, std::optional<std::pair<Key,Value>>());
-        table2_.assign(capacity_, std::optional<std::pair<Key,Value>>());
-        size_ = 0;
+    using key_type = Key;
+    using mapped_type = Value;
+    using hasher = Hasher;
+    using allocator_type = Allocator;
+
+    explicit MinimalPerfectHashMap(double gamma = 2.0, const Allocator& alloc = Allocator())
+        : hash_(), eq_(), gamma_(gamma), bits_(alloc), ranks_(alloc), level_offset_(alloc), level_bits_(alloc),
+          keys_(alloc), values_(alloc), fallback_(16, 0.875, alloc) {
+        if (!(gamma >= 1.0)) throw std::invalid_argument("MinimalPerfectHashMap: gamma must be >= 1");
     }
 
-    bool insert(const Key& k, const Value& v) {
-        if ((size_ + 1) > static_cast<size_t>(2 * capacity_ * max_load_)) {
-            rehash(next_prime(capacity_ * 2));
-        }
-        if (contains(k)) return false; // no duplicates
+    // Replaces the contents with items (same input as batch_load). Equal keys
+    // are resolved by dedup in input order. threads == 0: one per hardware thread.
+    void build(const std::vector<std::pair<Key,Value>>& items,
+               DedupPolicy dedup = DedupPolicy::LastWins, size_t threads = 0) {
+        const size_t n = items.size();
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        const size_t chunks = threads * 4;
+        auto chunk_range = [&](size_t c, size_t len) { return std::make_pair(c * len / chunks, (c + 1) * len / chunks); };
+        clear();
 
-        std::pair<Key,Value> cur = {k, v};
-        size_t table_id = 1;
-        for (size_t kick = 0; kick < max_kicks_; ++kick) {
-            if (table_id == 1) {
-                size_t idx = h1_(cur.first, capacity_);
-                if (!table1_[idx]) {
-                    table1_[idx] = cur; ++size_; return true;
-                } else {
-                    // evict
-                    std::swap(cur, *table1_[idx]);
-                    table_id = 2;
+        std::vector<uint64_t> hashes(n);
+        parallel_for(chunks, threads, [&](size_t c) {
+            for (size_t i = chunk_range(c, n).first; i < chunk_range(c, n).second; ++i)
+                hashes[i] = base_hash(items[i].first);
+        });
+
+        // 1. levels; `active` stays in input order so the fallback sees
+        //    duplicates in the order dedup expects
+        std::vector<size_t> active(n);
+        for (size_t i = 0; i < n; ++i) active[i] = i;
+        for (size_t level = 0; level < kMaxLevels && !active.empty(); ++level) {
+            const size_t words = std::max<size_t>(1, (static_cast<size_t>(gamma_ * active.size()) + 63) / 64);
+            const size_t nbits = words * 64;
+            std::unique_ptr<std::atomic<uint64_t>[]> seen(new std::atomic<uint64_t>[words]());
+            std::unique_ptr<std::atomic<uint64_t>[]> coll(new std::atomic<uint64_t>[words]());
+            const size_t m = active.size();
+            parallel_for(chunks, threads, [&](size_t c) {
+                for (size_t j = chunk_range(c, m).first; j < chunk_range(c, m).second; ++j) {
+                    size_t p = level_pos(hashes[active[j]], level, nbits);
+                    uint64_t bit = uint64_t(1) << (p & 63);
+                    if (seen[p >> 6].fetch_or(bit, std::memory_order_relaxed) & bit)
+                        coll[p >> 6].fetch_or(bit, std::memory_order_relaxed);
                 }
-            } else {
-                size_t idx = h2_(cur.first, capacity_);
-                if (!table2_[idx]) {
-                    table2_[idx] = cur; ++size_; return true;
-                } else {
-                    std::swap(cur, *table2_[idx]);
-                    table_id = 1;
+            });
+            const size_t off = bits_.size();
+            bits_.resize(off + words);
+            for (size_t w = 0; w < words; ++w)
+                bits_[off + w] = seen[w].load(std::memory_order_relaxed) & ~coll[w].load(std::memory_order_relaxed);
+            level_offset_.push_back(off * 64);
+            level_bits_.push_back(nbits);
+
+            std::vector<std::vector<size_t>> next(chunks);
+            parallel_for(chunks, threads, [&](size_t c) {
+                for (size_t j = chunk_range(c, m).first; j < chunk_range(c, m).second; ++j) {
+                    size_t p = level_pos(hashes[active[j]], level, nbits);
+                    if (coll[p >> 6].load(std::memory_order_relaxed) & (uint64_t(1) << (p & 63)))
+                        next[c].push_back(active[j]);
                 }
+            });
+            active.clear();
+            for (auto& v : next) active.insert(active.end(), v.begin(), v.end());
+            if (active.size() == m) {
+                // nothing placed: only equal hashes (duplicates) are left
+                bits_.resize(off);
+                level_offset_.pop_back();
+                level_bits_.pop_back();
+                break;
             }
         }
-        // too many kicks -> rehash to larger size and retry
-        rehash(next_prime(capacity_ * 2));
-        return insert(cur.first, cur.second);
+
+        // 2. rank samples: set bits before each 512-bit block
+        ranks_.resize(bits_.size() / kRankWords + 1);
+        size_t placed = 0;
+        for (size_t w = 0; w < bits_.size(); ++w) {
+            if (w % kRankWords == 0) ranks_[w / kRankWords] = placed;
+            placed += popcount64(bits_[w]);
+        }
+        if (bits_.size() % kRankWords == 0) ranks_.back() = placed;
+
+        // 3. leftovers get the indices after the ranked ones
+        keys_.resize(placed);
+        values_.resize(placed);
+        for (size_t i : active) {
+            size_t idx = keys_.size();
+            if (fallback_.try_emplace(items[i].first, idx)) {
+                keys_.push_back(items[i].first);
+                values_.push_back(items[i].second);
+            } else if (dedup == DedupPolicy::LastWins) {
+                values_[*fallback_.find_ptr(items[i].first)] = items[i].second;
+            }
+        }
+
+        // 4. every ranked index belongs to exactly one key: fill without locks
+        parallel_for(chunks, threads, [&](size_t c) {
+            for (size_t i = chunk_range(c, n).first; i < chunk_range(c, n).second; ++i) {
+                size_t idx = ranked_index(hashes[i]);
+                if (idx == npos) continue;
+                keys_[idx] = items[i].first;
+                values_[idx] = items[i].second;
+            }
+        });
     }
 
     std::optional<Value> find(const Key& k) const {
-        size_t i1 = h1_(k, capacity_);
-        if (table1_[i1] && eq_(table1_[i1]->first, k)) return table1_[i1]->second;
-        size_t i2 = h2_(k, capacity_);
-        if (table2_[i2] && eq_(table2_[i2]->first, k)) return table2_[i2]->second;
-        return std::nullopt;
+        const Value* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
     }
+    const Value* find_ptr(const Key& k) const { return lookup(k); }
+    Value* find_ptr(const Key& k) { return const_cast<Value*>(lookup(k)); }
+    bool contains(const Key& k) const { return lookup(k) != nullptr; }
 
-    bool contains(const Key& k) const { return static_cast<bool>(find(k)); }
+    template <typename K, typename = transparent_key_t<K, Hasher, KeyEqual>>
+    const Value* find_ptr(const K& k) const { return lookup(k); }
+    template <typename K, typename = transparent_key_t<K, Hasher, KeyEqual>>
+    bool contains(const K& k) const { return lookup(k) != nullptr; }
 
-    bool erase(const Key& k) {
-        size_t i1 = h1_(k, capacity_);
-        if (table1_[i1] && eq_(table1_[i1]->first, k)) { table1_[i1].reset(); --size_; return true; }
-        size_t i2 = h2_(k, capacity_);
-        if (table2_[i2] && eq_(table2_[i2]->first, k)) { table2_[i2].reset(); --size_; return true; }
-        return false;
+    size_t size() const noexcept { return keys_.size(); }
+    size_t levels() const noexcept { return level_bits_.size(); }
+    size_t fallback_size() const noexcept { return fallback_.size(); }
+    allocator_type get_allocator() const { return allocator_type(keys_.get_allocator()); }
+    // index overhead (level bits + rank samples), excluding keys and values
+    double bits_per_key() const noexcept {
+        return keys_.empty() ? 0.0 : 64.0 * double(bits_.size() + ranks_.size()) / double(keys_.size());
     }
 
-    size_t size() const noexcept { return size_; }
-    void clear() {
-        table1_.assign(capacity_, std::nullopt);
-        table2_.assign(capacity_, std::nullopt);
-        size_ = 0;
+    // capacity == size (minimal); longest_chain is the level count, the most
+    // bit probes a lookup can take. HASHING_STATS counts levels visited per
+    // lookup (the fallback map keeps its own counters).
+    HashMapStats stats() const {
+        HashMapStats s;
+        fill_structure(s, size(), size(), 0, levels());
+        op_stats_.fill(s);
+        return s;
     }
+    void reset_stats() noexcept { op_stats_.reset(); }
 
-    void batch_load(const std::vector<std::pair<Key,Value>>& items, bool dedup=false) {
-        if (!dedup) { for (auto &kv : items) insert(kv.first, kv.second); return; }
-        std::vector<std::pair<Key,Value>> tmp = items;
-        std::sort(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first < b.first; });
-        tmp.erase(std::unique(tmp.begin(), tmp.end(), [](auto &a, auto &b){ return a.first == b.first; }), tmp.end());
-        for (auto &kv : tmp) insert(kv.first, kv.second);
+    void clear() {
+        bits_.clear();
+        ranks_.clear();
+        level_offset_.clear();
+        level_bits_.clear();
+        keys_.clear();
+        values_.clear();
+        fallback_.clear();
     }
 
 private:
-    Hash1 h1_;
-    Hash2 h2_;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t kMaxLevels = 32;
+    static constexpr size_t kRankWords = 8; // 512-bit rank blocks
+
+    Hasher hash_;
     KeyEqual eq_;
-    size_t capacity_;
-    std::vector<std::optional<std::pair<Key,Value>>> table1_;
-    std::vector<std::optional<std::pair<Key,Value>>> table2_;
-    size_t size_;
-    double max_load_;
-    size_t max_kicks_;
+    double gamma_;
+    alloc_vector<uint64_t, Allocator> bits_;       // all levels, back to back
+    alloc_vector<size_t, Allocator> ranks_;        // set bits before each rank block
+    alloc_vector<size_t, Allocator> level_offset_; // first bit of each level in bits_
+    alloc_vector<size_t, Allocator> level_bits_;
+    alloc_vector<Key, Allocator> keys_;
+    alloc_vector<Value, Allocator> values_;
+    SwissHashMap<Key, size_t, Hasher, KeyEqual, Allocator> fallback_;
+    OpStats op_stats_;
 
-    void rehash(size_t new_cap) {
-        new_cap = next_prime(std::max<size_t>(new_cap, 3));
-        std::vector<std::pair<Key,Value>> items;
-        items.reserve(size_);
-        for (auto &o : table1_) if (o) items.push_back(*o);
-        for (auto &o : table2_) if (o) items.push_back(*o);
-        capacity_ = new_cap;
-        table1_.assign(capacity_, std::nullopt);
-        table2_.assign(capacity_, std::nullopt);
-        size_ = 0;
-        for (auto &kv : items) insert(kv.first, kv.second);
+    template <typename K>
+    uint64_t base_hash(const K& k) const { return mix64(static_cast<uint64_t>(hash_(k))); }
+    static size_t level_pos(uint64_t h, size_t level, size_t nbits) noexcept {
+        return reduce_range(mix64(h + (level + 1) * 0x9e3779b97f4a7c15ULL), nbits);
     }
-};
 
+    // index from the first level whose bit is set; npos if none (fallback key)
+    size_t ranked_index(uint64_t h, OpStats::Probe* probes = nullptr) const noexcept {
+        for (size_t l = 0; l < level_bits_.size(); ++l) {
+            if (probes) probes->step();
+            size_t p = level_offset_[l] + level_pos(h, l, level_bits_[l]);
+            size_t w = p >> 6;
+            uint64_t below = bits_[w] & ((uint64_t(2) << (p & 63)) - 1); // bits <= p
+            if (!(bits_[w] >> (p & 63) & 1)) continue;
+            size_t r = ranks_[w / kRankWords];
+            for (size_t i = w & ~(kRankWords - 1); i < w; ++i) r += popcount64(bits_[i]);
+            return r + popcount64(below) - 1;
+        }
+        return npos;
+    }
 
+    template <typename K>
+    const Value* lookup(const K& k) const {
+        OpStats::Probe probes(op_stats_);
+        size_t idx = ranked_index(base_hash(k), &probes);
+        if (idx == npos) {
+            if (fallback_.size() == 0) return nullptr;
+            const size_t* f = fallback_.find_ptr(k);
+            if (!f) return nullptr;
+            idx = *f;
+        }
+        return eq_(keys_[idx], k) ? &values_[idx] : nullptr;
+    }
+};
 
-template <
-    typename Key,
-    typename Value,
-    typename H = std::hash<Key>,
-    typename KeyEq = std::equal_to<Key>
->
-class ChainingHashMap {
+// -----------------------------
+// Blocked Bloom filter (split-block layout): each key sets one bit in each of
+// the eight 32-bit words of a single 32-byte block, so an add or a query
+// touches one cache line. About 0.15% false positives at 16 bits per key.
+// -----------------------------
+class BlockedBloomFilter {
 public:
-    using key_type = Key;
-    using mapped_type = Value;
-    using value_type = std::pair<Key, Value>;
-    using hasher = H;
-    using key_equal = KeyEq;
+    explicit BlockedBloomFilter(size_t expected_keys = 0, size_t bits_per_key = 16) {
+        reset(expected_keys, bits_per_key);
+    }
 
-    explicit ChainingHashMap(size_t initial_buckets = 16, double max_load = 0.75)
-        : hash_(), eq_(), buckets_(std::max<size_t>(1, initial_buckets)),
-          size_(0), max_load_factor_(max_load)
-    {}
+    // Resizes for expected_keys and clears.
+    void reset(size_t expected_keys, size_t bits_per_key) {
+        size_t bits = std::max<size_t>(expected_keys, 1) * std::max<size_t>(bits_per_key, 1);
+        blocks_.assign((bits + kBlockBits - 1) / kBlockBits, Block{});
+    }
+    void clear() noexcept { std::fill(blocks_.begin(), blocks_.end(), Block{}); }
 
-    // Insert or update. Returns true if a new element was inserted, false if an existing
-    // element was updated.
-    bool insert(const Key &k, const Value &v) {
-        maybe_rehash_for_insert();
-        size_t idx = bucket_index(k);
-        auto &bucket = buckets_[idx];
-
-        // linear scan in bucket using LinkedList.at(i)
-        for (size_t i = 0, n = bucket.size(); i < n; ++i) {
-            auto &kv = bucket.at(i);
-            if (eq_(kv.first, k)) {
-                kv.second = v; // update
-                return false;
-            }
+    // h: a well-mixed 64-bit hash; high bits pick the block, low bits the words' bits
+    void add(uint64_t h) noexcept {
+        Block& b = blocks_[reduce_range(h, blocks_.size())];
+        for (size_t i = 0; i < 8; ++i) b.w[i] |= bit(static_cast<uint32_t>(h), i);
+    }
+    bool may_contain(uint64_t h) const noexcept {
+        const Block& b = blocks_[reduce_range(h, blocks_.size())];
+        uint32_t missing = 0; // branch-free, vectorizes
+        for (size_t i = 0; i < 8; ++i) missing |= bit(static_cast<uint32_t>(h), i) & ~b.w[i];
+        return missing == 0;
+    }
+
+    size_t bits() const noexcept { return blocks_.size() * kBlockBits; }
+
+private:
+    static constexpr size_t kBlockBits = 256;
+    struct alignas(32) Block { uint32_t w[8]; };
+
+    std::vector<Block> blocks_;
+
+    static uint32_t bit(uint32_t h, size_t i) noexcept {
+        static constexpr uint32_t kSalt[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                              0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+        return uint32_t(1) << ((h * kSalt[i]) >> 27);
+    }
+};
+
+// Any single-threaded map above behind a blocked Bloom filter: lookups of
+// absent keys are usually answered from one filter cache line without
+// touching the table. The filter is sized for twice the current element
+// count; it is rebuilt from the map (for_each) whenever the map outgrows it,
+// which tracks the map's own doubling rehashes, and after enough erases that
+// stale bits would raise the false-positive rate.
+template <typename Map, typename Hasher = std::hash<typename Map::key_type>>
+class BloomFilteredMap {
+public:
+    using key_type = typename Map::key_type;
+    using mapped_type = typename Map::mapped_type;
+    using map_type = Map;
+
+    explicit BloomFilteredMap(size_t bits_per_key = 16, Map map = Map())
+        : map_(std::move(map)), hash_(), bits_per_key_(bits_per_key) {
+        rebuild();
+    }
+    BloomFilteredMap(const BloomFilteredMap&) = default;
+    BloomFilteredMap& operator=(const BloomFilteredMap&) = default;
+    // A moved-from filter has no blocks, so the source is cleared to get one.
+    BloomFilteredMap(BloomFilteredMap&& other)
+        : map_(std::move(other.map_)), hash_(std::move(other.hash_)), bits_per_key_(other.bits_per_key_),
+          filter_(std::move(other.filter_)), filter_keys_(other.filter_keys_), stale_(other.stale_) {
+        other.clear();
+    }
+    BloomFilteredMap& operator=(BloomFilteredMap&& other) {
+        if (this != &other) {
+            map_ = std::move(other.map_);
+            hash_ = std::move(other.hash_);
+            bits_per_key_ = other.bits_per_key_;
+            filter_ = std::move(other.filter_);
+            filter_keys_ = other.filter_keys_;
+            stale_ = other.stale_;
+            other.clear();
         }
+        return *this;
+    }
 
-        // not found -> insert at back
-        bucket.push_back(std::make_pair(k, v));
-        ++size_;
+    bool insert(const key_type& k, const mapped_type& v) { return emplace(k, v); }
+    bool insert(key_type&& k, mapped_type&& v) { return emplace(std::move(k), std::move(v)); }
+
+    template <typename K, typename... Args>
+    bool emplace(K&& k, Args&&... args) {
+        uint64_t h = hash_of(k);
+        return added(map_.emplace(std::forward<K>(k), std::forward<Args>(args)...), h);
+    }
+    template <typename K, typename... Args>
+    bool try_emplace(K&& k, Args&&... args) {
+        uint64_t h = hash_of(k);
+        return added(map_.try_emplace(std::forward<K>(k), std::forward<Args>(args)...), h);
+    }
+
+    std::optional<mapped_type> find(const key_type& k) const {
+        const mapped_type* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+    const mapped_type* find_ptr(const key_type& k) const { return filter_.may_contain(hash_of(k)) ? map_.find_ptr(k) : nullptr; }
+    mapped_type* find_ptr(const key_type& k) { return filter_.may_contain(hash_of(k)) ? map_.find_ptr(k) : nullptr; }
+    bool contains(const key_type& k) const { return filter_.may_contain(hash_of(k)) && map_.contains(k); }
+
+    template <typename K, typename = transparent_key_t<K, Hasher>>
+    const mapped_type* find_ptr(const K& k) const { return filter_.may_contain(hash_of(k)) ? map_.find_ptr(k) : nullptr; }
+    template <typename K, typename = transparent_key_t<K, Hasher>>
+    bool contains(const K& k) const { return filter_.may_contain(hash_of(k)) && map_.contains(k); }
+
+    bool erase(const key_type& k) {
+        if (!filter_.may_contain(hash_of(k)) || !map_.erase(k)) return false;
+        if (++stale_ > std::max(map_.size(), kMinKeys)) rebuild();
         return true;
     }
 
-    // Remove key; returns true if removed
-    bool erase(const Key &k) {
-        size_t idx = bucket_index(k);
-        auto &bucket = buckets_[idx];
-        for (size_t i = 0, n = bucket.size(); i < n; ++i) {
-            auto &kv = bucket.at(i);
-            if (eq_(kv.first, k)) {
-                bucket.pop_at(i);
-                --size_;
-                return true;
-            }
-        }
-        return false;
+    size_t size() const noexcept { return map_.size(); }
+
+    void reserve(size_t n) { map_.reserve(n); }
+    // Also resizes the filter for the current element count.
+    void shrink_to_fit() {
+        map_.shrink_to_fit();
+        rebuild();
+    }
+    // Also shrinks the filter back to its minimum size.
+    void clear() {
+        map_.clear();
+        rebuild();
     }
 
-    // Returns std::optional<Value> (copy) if found
-    std::optional<Value> find(const Key &k) const {
-        size_t idx = bucket_index(k);
-        const auto &bucket = buckets_[idx];
-        for (size_t i = 0, n = bucket.size(); i < n; ++i) {
-            const auto &kv = bucket.at(i);
-            if (eq_(kv.first, k)) return kv.second;
-        }
-        return std::nullopt;
+    template <typename F>
+    void for_each(F&& f) const { map_.for_each(std::forward<F>(f)); }
+
+    // The wrapped map's stats; lookups the filter rejects never reach it and
+    // are not counted.
+    HashMapStats stats() const { return map_.stats(); }
+    void reset_stats() { map_.reset_stats(); }
+
+    // Read access to the wrapped map (batch lookups, stats, ...). Modifying
+    // it directly would bypass the filter, so only const access is given.
+    const Map& map() const noexcept { return map_; }
+
+private:
+    static constexpr size_t kMinKeys = 64;
+
+    Map map_;
+    Hasher hash_;
+    size_t bits_per_key_;
+    BlockedBloomFilter filter_;
+    size_t filter_keys_ = 0; // element count the filter is sized for
+    size_t stale_ = 0;       // erased keys still set in the filter
+
+    template <typename K>
+    uint64_t hash_of(const K& k) const { return mix64(static_cast<uint64_t>(hash_(k))); }
+
+    bool added(bool inserted, uint64_t h) {
+        if (!inserted) return false;
+        if (map_.size() > filter_keys_) rebuild();
+        else filter_.add(h);
+        return true;
     }
 
-    bool contains(const Key &k) const { return static_cast<bool>(find(k)); }
+    void rebuild() {
+        filter_keys_ = std::max(map_.size() * 2, kMinKeys);
+        filter_.reset(filter_keys_, bits_per_key_);
+        map_.for_each([this](const key_type& k, const mapped_type&) { filter_.add(hash_of(k)); });
+        stale_ = 0;
+    }
+};
 
-    // operator[]: insert default-constructed value if missing, return reference
-    Value &operator[](const Key &k) {
-        maybe_rehash_for_insert();
-        size_t idx = bucket_index(k);
-        auto &bucket = buckets_[idx];
-        for (size_t i = 0, n = bucket.size(); i < n; ++i) {
-            auto &kv = bucket.at(i);
-            if (eq_(kv.first, k)) return kv.second;
-        }
-        // not present -> insert default value and return ref to back()
-        bucket.push_back(std::make_pair(k, Value()));
-        ++size_;
-        return bucket.back().second;
+// Small-size optimization in front of any map above, for the many-tiny-maps
+// case (per-request attribute bags and the like). Up to N entries live inline
+// in the object and are found by a linear scan, so an empty or small map never
+// allocates; the (N+1)-th insert moves them into a heap-allocated,
+// default-constructed Map and every operation forwards to it from then on.
+// A spilled map stays spilled until clear(), or shrink_to_fit() once size()
+// is back to N or less. Keys and values must be default-constructible, as for
+// the probing maps' slots.
+template <typename Map, size_t N = 8, typename KeyEqual = std::equal_to<typename Map::key_type>>
+class SmallHashMap {
+    static_assert(N > 0, "SmallHashMap needs at least one inline entry");
+public:
+    using key_type = typename Map::key_type;
+    using mapped_type = typename Map::mapped_type;
+    using map_type = Map;
+    static constexpr size_t inline_capacity = N;
+
+    SmallHashMap() = default;
+    SmallHashMap(const SmallHashMap& other)
+        : items_(other.items_), size_(other.size_), big_(other.big_ ? std::make_unique<Map>(*other.big_) : nullptr),
+          op_stats_(other.op_stats_) {}
+    SmallHashMap(SmallHashMap&& other) noexcept : SmallHashMap() { swap(other); }
+    SmallHashMap& operator=(SmallHashMap other) noexcept {
+        swap(other);
+        return *this;
     }
 
-    size_t size() const noexcept { return size_; }
-    bool empty() const noexcept { return size_ == 0; }
+    void swap(SmallHashMap& other) noexcept {
+        using std::swap;
+        swap(items_, other.items_);
+        swap(size_, other.size_);
+        swap(big_, other.big_);
+        swap(eq_, other.eq_);
+        swap(op_stats_, other.op_stats_);
+    }
 
-    void clear() noexcept {
-        for (auto &b : buckets_) {
-            b.clear();
-        }
-        size_ = 0;
+    bool insert(const key_type& k, const mapped_type& v) { return emplace_impl(k, true, v); }
+    bool insert(key_type&& k, mapped_type&& v) { return emplace_impl(std::move(k), true, std::move(v)); }
+
+    template <typename... Args>
+    bool emplace(const key_type& k, Args&&... args) { return emplace_impl(k, true, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool emplace(key_type&& k, Args&&... args) { return emplace_impl(std::move(k), true, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    bool try_emplace(const key_type& k, Args&&... args) { return emplace_impl(k, false, std::forward<Args>(args)...); }
+    template <typename... Args>
+    bool try_emplace(key_type&& k, Args&&... args) {
+        return emplace_impl(std::move(k), false, std::forward<Args>(args)...);
     }
 
-    size_t bucket_count() const noexcept { return buckets_.size(); }
+    std::optional<mapped_type> find(const key_type& k) const {
+        const mapped_type* v = find_ptr(k);
+        if (!v) return std::nullopt;
+        return *v;
+    }
+    const mapped_type* find_ptr(const key_type& k) const { return lookup(k); }
+    mapped_type* find_ptr(const key_type& k) { return const_cast<mapped_type*>(lookup(k)); }
+    bool contains(const key_type& k) const { return lookup(k) != nullptr; }
 
-    double load_factor() const noexcept {
-        return static_cast<double>(size_) / static_cast<double>(bucket_count());
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    const mapped_type* find_ptr(const K& k) const { return lookup(k); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    mapped_type* find_ptr(const K& k) { return const_cast<mapped_type*>(lookup(k)); }
+    template <typename K, typename = transparent_key_t<K, KeyEqual>>
+    bool contains(const K& k) const { return lookup(k) != nullptr; }
+
+    bool erase(const key_type& k) {
+        if (big_) return big_->erase(k);
+        size_t i = scan(k);
+        if (i == size_) return false;
+        // keep the entries packed: the last one fills the hole
+        if (i != size_ - 1) items_[i] = std::move(items_[size_ - 1]);
+        items_[--size_] = value_type();
+        return true;
     }
 
-    double max_load_factor() const noexcept { return max_load_factor_; }
-    void max_load_factor(double lf) {
-        if (!(lf > 0.0)) throw std::invalid_argument("max_load_factor must be > 0");
-        max_load_factor_ = lf;
+    size_t size() const noexcept { return big_ ? big_->size() : size_; }
+    bool spilled() const noexcept { return big_ != nullptr; }
+
+    // Spills right away when n does not fit inline.
+    void reserve(size_t n) {
+        if (n <= N) return;
+        if (!big_) spill(n);
+        else big_->reserve(n);
+    }
+    // Moves the entries back inline and frees the table when they fit,
+    // otherwise shrinks the table.
+    void shrink_to_fit() {
+        if (!big_) return;
+        if (big_->size() > N) {
+            big_->shrink_to_fit();
+            return;
+        }
+        OpStats::Rehash timer(op_stats_);
+        size_ = 0;
+        big_->for_each([this](const key_type& k, auto& v) {
+            items_[size_].first = k;
+            items_[size_].second = std::move(v);
+            ++size_;
+        });
+        big_.reset();
+    }
+    void clear() {
+        big_.reset();
+        for (size_t i = 0; i < size_; ++i) items_[i] = value_type();
+        size_ = 0;
     }
 
-    // Batch load (vector of pairs) - optionally deduplicate by inserting in order (later inserts overwrite earlier)
-    void batch_load(const std::vector<value_type> &items, bool dedup = false) {
-        if (!dedup) {
-            for (const auto &kv : items) insert(kv.first, kv.second);
-        } else {
-            // simple dedup: insert in sequence (last overwrite previous)
-            for (const auto &kv : items) insert(kv.first, kv.second);
+    template <typename F>
+    void for_each(F&& f) const {
+        if (big_) {
+            std::as_const(*big_).for_each(std::forward<F>(f));
+            return;
+        }
+        for (size_t i = 0; i < size_; ++i) f(items_[i].first, items_[i].second);
+    }
+    template <typename F>
+    void for_each(F&& f) {
+        if (big_) {
+            big_->for_each(std::forward<F>(f));
+            return;
         }
+        for (size_t i = 0; i < size_; ++i) f(std::as_const(items_[i].first), items_[i].second);
     }
 
-    // Rehash: explicitly change bucket count (will be adjusted to at least 1)
-    void rehash(size_t new_bucket_count) {
-        new_bucket_count = std::max<size_t>(1, new_bucket_count);
-        std::vector<LinkedList<value_type>> new_buckets(new_bucket_count);
+    // Inline: N slots and the scan length as the longest chain. Spilled: the
+    // table's stats. The HASHING_STATS counters add up both phases; inline
+    // scans count one probe per key compared and a spill counts as a rehash.
+    HashMapStats stats() const {
+        HashMapStats s;
+        if (big_) s = big_->stats();
+        else fill_structure(s, size_, N, 0, size_);
+        op_stats_.fill(s);
+        return s;
+    }
+    void reset_stats() noexcept {
+        op_stats_.reset();
+        if (big_) big_->reset_stats();
+    }
 
-        // move elements
-        for (auto &b : buckets_) {
-            for (size_t i = 0, n = b.size(); i < n; ++i) {
-                auto kv = b.at(i); // copy
-                size_t idx = static_cast<size_t>(hash_(kv.first)) % new_bucket_count;
-                new_buckets[idx].push_back(kv);
-            }
+private:
+    using value_type = std::pair<key_type, mapped_type>;
+
+    std::array<value_type, N> items_{};
+    size_t size_ = 0; // inline entries; 0 once spilled
+    std::unique_ptr<Map> big_;
+    KeyEqual eq_;
+    OpStats op_stats_;
+
+    // Index of k among the inline entries, size_ if absent.
+    template <typename K>
+    size_t scan(const K& k) const {
+        OpStats::Probe probes(op_stats_);
+        size_t i = 0;
+        for (; i < size_; ++i) {
+            probes.step();
+            if (eq_(items_[i].first, k)) break;
         }
-        buckets_.swap(new_buckets);
+        return i;
     }
 
-private:
-    hasher hash_;
-    key_equal eq_;
-    std::vector<LinkedList<value_type>> buckets_;
-    size_t size_;
-    double max_load_factor_;
+    template <typename K>
+    const mapped_type* lookup(const K& k) const {
+        if (big_) return std::as_const(*big_).find_ptr(k);
+        size_t i = scan(k);
+        return i == size_ ? nullptr : &items_[i].second;
+    }
 
-    inline size_t bucket_index(const Key &k) const {
-        return static_cast<size_t>(hash_(k)) % buckets_.size();
+    template <typename K, typename... Args>
+    bool emplace_impl(K&& k, bool assign, Args&&... args) {
+        if (!big_) {
+            size_t i = scan(k);
+            if (i != size_) {
+                if (assign) assign_from(items_[i].second, std::forward<Args>(args)...);
+                return false;
+            }
+            if (size_ < N) {
+                items_[size_].first = std::forward<K>(k);
+                assign_from(items_[size_].second, std::forward<Args>(args)...);
+                ++size_;
+                return true;
+            }
+            spill(2 * N);
+        }
+        if (assign) return big_->emplace(std::forward<K>(k), std::forward<Args>(args)...);
+        return big_->try_emplace(std::forward<K>(k), std::forward<Args>(args)...);
     }
 
-    void maybe_rehash_for_insert() {
-        if (load_factor() > max_load_factor_) {
-            // double buckets
-            rehash(buckets_.size() * 2);
+    // Moves the inline entries into a new table with room for n.
+    void spill(size_t n) {
+        OpStats::Rehash timer(op_stats_);
+        auto big = std::make_unique<Map>();
+        big->reserve(n);
+        for (size_t i = 0; i < size_; ++i) {
+            big->insert(std::move(items_[i].first), std::move(items_[i].second));
+            items_[i] = value_type();
         }
+        size_ = 0;
+        big_ = std::move(big);
     }
 };
 
+// -----------------------------
+// pmr aliases, like std::pmr::unordered_map: the maps above with a
+// std::pmr::polymorphic_allocator, e.g.
+//   std::pmr::monotonic_buffer_resource arena;
+//   pmr::SwissHashMap<int, int> m(16, 0.875, &arena);
+// -----------------------------
+#if defined(HASHING_HAVE_PMR)
+namespace pmr {
+template <typename Key, typename Value>
+using allocator = std::pmr::polymorphic_allocator<std::pair<const Key, Value>>;
+
+template <typename Key, typename Value,
+          typename HashPolicy = DivisionHash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename CapacityPolicy = PrimeCapacity,
+          typename Layout = AoSLayout>
+using LinearProbingHashMap = ::LinearProbingHashMap<Key, Value, HashPolicy, KeyEqual, CapacityPolicy, Layout, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename HashPolicy = DivisionHash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename CapacityPolicy = PrimeCapacity,
+          typename Layout = AoSLayout>
+using QuadraticProbingHashMap = ::QuadraticProbingHashMap<Key, Value, HashPolicy, KeyEqual, CapacityPolicy, Layout, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename HashPolicy1 = DivisionHash<Key>,
+          typename HashPolicy2 = DivisionHash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename CapacityPolicy = PrimeCapacity,
+          typename Layout = AoSLayout>
+using DoubleHashingHashMap = ::DoubleHashingHashMap<Key, Value, HashPolicy1, HashPolicy2, KeyEqual, CapacityPolicy, Layout, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename Hash1 = DivisionHash<Key>,
+          typename Hash2 = MidSquareHash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+using CuckooHashMap = ::CuckooHashMap<Key, Value, Hash1, Hash2, KeyEqual, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename HashPolicy = DivisionHash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+using BucketizedCuckooHashMap = ::BucketizedCuckooHashMap<Key, Value, HashPolicy, KeyEqual, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename HashPolicy = DivisionHash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+using ConcurrentCuckooHashMap = ::ConcurrentCuckooHashMap<Key, Value, HashPolicy, KeyEqual, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+using SwissHashMap = ::SwissHashMap<Key, Value, Hasher, KeyEqual, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename HashPolicy = DivisionHash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename CapacityPolicy = PrimeCapacity>
+using RobinHoodHashMap = ::RobinHoodHashMap<Key, Value, HashPolicy, KeyEqual, CapacityPolicy, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename HashPolicy = DivisionHash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename CapacityPolicy = PrimeCapacity>
+using HopscotchHashMap = ::HopscotchHashMap<Key, Value, HashPolicy, KeyEqual, CapacityPolicy, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename HashPolicy = DivisionHash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename CapacityPolicy = PrimeCapacity,
+          typename Layout = AoSLayout>
+using ConcurrentHashMap = ::ConcurrentHashMap<Key, Value, HashPolicy, KeyEqual, CapacityPolicy, Layout, allocator<Key, Value>>;
+template <typename Key, typename Value, typename H = std::hash<Key>, typename KeyEq = std::equal_to<Key>>
+using ChainingHashMap = ::ChainingHashMap<Key, Value, H, KeyEq, allocator<Key, Value>>;
+template <typename Key, typename Value,
+          typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+using MinimalPerfectHashMap = ::MinimalPerfectHashMap<Key, Value, Hasher, KeyEqual, allocator<Key, Value>>;
+} // namespace pmr
+#endif
@@ -0,0 +1,279 @@
+// hashing_bench.cpp
+// C++17 - hash policy quality and throughput benchmark for hashing.cpp
+//
+// Build: g++ -std=c++17 -O2 -pthread hashing_bench.cpp -o hashing_bench
+// Run:   ./hashing_bench [keys] [filter]
+//   keys   keys per run (default 200000)
+//   filter only runs whose "dist/map/hash" name contains it, e.g. "zipf/",
+//          "/linear/" or "/wyhash"
+//
+// Every hash policy runs against every map type on each key distribution:
+//   seq      0, 1, 2, ...
+//   strided  multiples of 1024 (all low bits zero)
+//   random   random 64-bit ids
+//   zipf     random ids, inserted and looked up with Zipf(0.99) skew (the
+//            insert stream repeats hot keys, which become updates)
+//   url      URL-shaped strings (string policies only)
+// A run inserts the keys into an empty map, then looks up as many present
+// keys (hit) and absent keys (miss), and prints ns/op for each phase plus the
+// average probe length of the hit and miss lookups from stats(). Probe counts
+// need HASHING_STATS, which this file turns on by default; the counters cost
+// a few ns per operation, so build with -DHASHING_STATS=0 for clean timings
+// (the probe columns then print "-"). Runs that degrade badly are cut short
+// after kPhaseBudgetSeconds per phase and marked.
+#ifndef HASHING_STATS
+#define HASHING_STATS 1
+#endif
+#include "hashing.cpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// -----------------------------
+// Workloads
+// -----------------------------
+template <typename Key>
+struct Workload {
+    const char* name;
+    std::vector<Key> inserts, hits, misses;
+};
+
+// Keys are mix64(i): distinct for distinct i, so misses never collide with hits.
+inline std::vector<uint64_t> random_ids(size_t first, size_t n) {
+    std::vector<uint64_t> v(n);
+    for (size_t i = 0; i < n; ++i) v[i] = mix64(first + i);
+    return v;
+}
+
+// n draws of ranks in [0, universe) with P(rank r) ~ 1 / (r + 1)^s
+inline std::vector<size_t> zipf_ranks(size_t universe, size_t n, double s, std::mt19937_64& rng) {
+    std::vector<double> cdf(universe);
+    double sum = 0.0;
+    for (size_t r = 0; r < universe; ++r) cdf[r] = sum += 1.0 / std::pow(double(r + 1), s);
+    std::uniform_real_distribution<double> u(0.0, sum);
+    std::vector<size_t> out(n);
+    for (auto& r : out) r = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin());
+    return out;
+}
+
+inline std::vector<Workload<uint64_t>> int_workloads(size_t n, std::mt19937_64& rng) {
+    std::vector<Workload<uint64_t>> w;
+    auto shuffled = [&](std::vector<uint64_t> v) {
+        std::shuffle(v.begin(), v.end(), rng);
+        return v;
+    };
+
+    Workload<uint64_t> seq{"seq", {}, {}, {}};
+    for (uint64_t i = 0; i < n; ++i) seq.inserts.push_back(i), seq.misses.push_back(n + i);
+    seq.hits = shuffled(seq.inserts);
+    w.push_back(std::move(seq));
+
+    Workload<uint64_t> strided{"strided", {}, {}, {}};
+    for (uint64_t i = 0; i < n; ++i) strided.inserts.push_back(i << 10), strided.misses.push_back((n + i) << 10);
+    strided.hits = shuffled(strided.inserts);
+    w.push_back(std::move(strided));
+
+    Workload<uint64_t> random{"random", random_ids(0, n), {}, random_ids(n, n)};
+    random.hits = shuffled(random.inserts);
+    w.push_back(std::move(random));
+
+    Workload<uint64_t> zipf{"zipf", {}, {}, random_ids(n, n)};
+    std::vector<uint64_t> ids = random_ids(0, n);
+    for (size_t r : zipf_ranks(n, n, 0.99, rng)) zipf.inserts.push_back(ids[r]);
+    for (size_t r : zipf_ranks(n, n, 0.99, rng)) zipf.hits.push_back(ids[r]);
+    // every hit key must be present: top up with the ranks the insert stream missed
+    SwissHashMap<uint64_t, char> present;
+    for (uint64_t k : zipf.inserts) present.insert(k, 1);
+    for (uint64_t k : zipf.hits)
+        if (present.insert(k, 1)) zipf.inserts.push_back(k);
+    w.push_back(std::move(zipf));
+    return w;
+}
+
+// https://<host>/<section>/<id>[?query], a unique id per key
+inline Workload<std::string> url_workload(size_t n, std::mt19937_64& rng) {
+    static const char* hosts[] = {"www.example.com", "cdn.example.net", "api.shop.example.org", "m.news.example.com",
+                                  "static.images.example.io", "blog.example.dev", "accounts.example.com", "example.co.uk"};
+    static const char* sections[] = {"product", "item", "user/profile", "search", "articles/2024", "assets/img",
+                                     "v2/orders", "category/books/fiction"};
+    static const char* queries[] = {"", "", "?ref=home", "?utm_source=newsletter&utm_medium=email", "?page=2&sort=price"};
+    std::vector<uint64_t> ids(2 * n);
+    for (size_t i = 0; i < ids.size(); ++i) ids[i] = i;
+    std::shuffle(ids.begin(), ids.end(), rng);
+    auto url = [&](uint64_t id) {
+        uint64_t h = mix64(id);
+        return std::string("https://") + hosts[h % 8] + "/" + sections[(h >> 8) % 8] + "/" + std::to_string(id) +
+               queries[(h >> 16) % 5];
+    };
+    Workload<std::string> w{"url", {}, {}, {}};
+    for (size_t i = 0; i < n; ++i) w.inserts.push_back(url(ids[i])), w.misses.push_back(url(ids[n + i]));
+    w.hits = w.inserts;
+    std::shuffle(w.hits.begin(), w.hits.end(), rng);
+    return w;
+}
+
+// -----------------------------
+// Policies and maps under test
+// -----------------------------
+
+// UniversalHash has no default constructor; fixed random parameters.
+template <typename Key>
+struct BenchUniversalHash : UniversalHash<Key> {
+    BenchUniversalHash() : UniversalHash<Key>(0x2545f4914f6cdd1dULL, 0x9e3779b97f4a7c15ULL) {}
+};
+
+// Table-2 hash for CuckooHashMap: the policy's own second().
+template <typename Policy>
+struct SecondHash : Policy {
+    template <typename K>
+    size_t operator()(const K& k, size_t mod) const { return Policy::second(k, mod) % mod; }
+};
+
+// std::hash-style adapter for the maps that take a Hasher (SwissHashMap,
+// ChainingHashMap): the policy reduced onto its full range.
+template <typename Policy>
+struct PolicyHasher {
+    Policy policy;
+    template <typename K>
+    size_t operator()(const K& k) const { return policy(k, kHashRange); }
+};
+
+template <typename T>
+struct Tag { using type = T; };
+
+template <typename Key, typename F>
+void for_each_int_policy(F&& f) {
+    f(Tag<DivisionHash<Key>>(), "division");
+    f(Tag<MultiplicationHash<Key>>(), "multiplication");
+    f(Tag<MidSquareHash<Key>>(), "midsquare");
+    f(Tag<BenchUniversalHash<Key>>(), "universal");
+    f(Tag<IntegerMixHash<Key>>(), "intmix");
+}
+
+template <typename F>
+void for_each_string_policy(F&& f) {
+    f(Tag<PolynomialRollingHash>(), "polynomial");
+    f(Tag<WyHash>(), "wyhash");
+    f(Tag<Fnv1aHash>(), "fnv1a");
+}
+
+template <typename Key, typename Value, typename P, typename F>
+void for_each_map(F&& f) {
+    f(Tag<LinearProbingHashMap<Key, Value, P>>(), "linear");
+    f(Tag<QuadraticProbingHashMap<Key, Value, P>>(), "quadratic");
+    f(Tag<DoubleHashingHashMap<Key, Value, P, P>>(), "double");
+    f(Tag<RobinHoodHashMap<Key, Value, P>>(), "robinhood");
+    f(Tag<HopscotchHashMap<Key, Value, P>>(), "hopscotch");
+    f(Tag<CuckooHashMap<Key, Value, P, SecondHash<P>>>(), "cuckoo");
+    f(Tag<BucketizedCuckooHashMap<Key, Value, P>>(), "bcuckoo");
+    if constexpr (std::is_trivially_copyable<Key>::value)
+        f(Tag<ConcurrentCuckooHashMap<Key, Value, P>>(), "ccuckoo");
+    f(Tag<SwissHashMap<Key, Value, PolicyHasher<P>>>(), "swiss");
+    f(Tag<ChainingHashMap<Key, Value, PolicyHasher<P>>>(), "chaining");
+    f(Tag<ConcurrentHashMap<Key, Value, P>>(), "sharded");
+}
+
+// -----------------------------
+// Runner
+// -----------------------------
+struct BenchResult {
+    double insert_ns = 0, hit_ns = 0, miss_ns = 0;
+    double hit_probes = 0, miss_probes = 0;
+    double load = 0;
+    bool cut = false; // some phase hit kPhaseBudget
+};
+
+// Pathological policy/map/key combinations go quadratic; a phase that runs
+// past this stops early and reports ns/op over the operations it did.
+constexpr double kPhaseBudgetSeconds = 2.0;
+
+static volatile uint64_t g_sink; // keeps lookups from being optimized away
+
+// Applies op to keys[0, n) or until the budget runs out; returns ns/op and
+// sets done to the number of keys processed.
+template <typename Key, typename Op>
+double timed_phase(const Key* keys, size_t n, size_t& done, Op&& op) {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    const auto deadline = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(kPhaseBudgetSeconds));
+    done = 0;
+    while (done < n) {
+        size_t end = std::min(n, done + 1024);
+        for (; done < end; ++done) op(keys[done]);
+        if (clock::now() > deadline) break;
+    }
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count() / double(std::max<size_t>(done, 1));
+}
+
+template <typename Map, typename Key>
+BenchResult run(const Workload<Key>& w) {
+    BenchResult r;
+    Map m;
+    uint64_t v = 0, sink = 0;
+    size_t done;
+
+    r.insert_ns = timed_phase(w.inserts.data(), w.inserts.size(), done, [&](const Key& k) { m.insert(k, ++v); });
+    // a cut-short insert leaves most hit keys absent: look up the inserted prefix instead
+    bool cut = done < w.inserts.size();
+    const Key* hits = cut ? w.inserts.data() : w.hits.data();
+    size_t hit_count = cut ? done : w.hits.size();
+    r.cut = cut;
+
+    m.reset_stats();
+    r.hit_ns = timed_phase(hits, hit_count, done, [&](const Key& k) { sink += m.find(k).value_or(0); });
+    r.cut |= done < hit_count;
+    r.hit_probes = m.stats().avg_probe();
+
+    m.reset_stats();
+    r.miss_ns = timed_phase(w.misses.data(), w.misses.size(), done, [&](const Key& k) { sink += m.find(k).has_value(); });
+    r.cut |= done < w.misses.size();
+    HashMapStats s = m.stats();
+    r.miss_probes = s.avg_probe();
+    r.load = s.load_factor;
+
+    if (sink == 0) g_sink = g_sink + 1;
+    return r;
+}
+
+template <typename Key, typename Value, typename PolicyLoop>
+void bench(const Workload<Key>& w, const std::string& filter, PolicyLoop&& policies) {
+    policies([&](auto policy, const char* hash_name) {
+        using P = typename decltype(policy)::type;
+        for_each_map<Key, Value, P>([&](auto map, const char* map_name) {
+            std::string name = std::string(w.name) + "/" + map_name + "/" + hash_name;
+            if (name.find(filter) == std::string::npos) return;
+            BenchResult r;
+            try {
+                r = run<typename decltype(map)::type>(w);
+            } catch (const std::exception& e) {
+                std::printf("%-8s %-10s %-15s failed: %s\n", w.name, map_name, hash_name, e.what());
+                return;
+            }
+            std::printf("%-8s %-10s %-15s %8.1f %8.1f %8.1f", w.name, map_name, hash_name, r.insert_ns, r.hit_ns, r.miss_ns);
+            if (HASHING_STATS) std::printf(" %9.2f %9.2f", r.hit_probes, r.miss_probes);
+            else std::printf(" %9s %9s", "-", "-");
+            std::printf(" %6.2f%s\n", r.load, r.cut ? "  (cut short)" : "");
+            std::fflush(stdout);
+        });
+    });
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    std::string filter = argc > 2 ? argv[2] : "";
+    if (n == 0) {
+        std::fprintf(stderr, "usage: %s [keys] [filter]\n", argv[0]);
+        return 1;
+    }
+    std::mt19937_64 rng(42);
+
+    std::printf("%zu keys per run%s\n", n, HASHING_STATS ? "" : " (HASHING_STATS off: no probe counts)");
+    std::printf("%-8s %-10s %-15s %8s %8s %8s %9s %9s %6s\n", "dist", "map", "hash", "ins ns", "hit ns", "miss ns",
+                "hit prb", "miss prb", "load");
+    for (const auto& w : int_workloads(n, rng))
+        bench<uint64_t, uint64_t>(w, filter, [](auto&& f) { for_each_int_policy<uint64_t>(f); });
+    bench<std::string, uint64_t>(url_workload(n, rng), filter, [](auto&& f) { for_each_string_policy(f); });
+    return 0;
+}
@@ -0,0 +1,311 @@
+// hashing_demo.cpp
+// C++17 - self-check for hashing.cpp, against a std::unordered_map reference
+//
+// Build: g++ -std=c++17 -O2 -pthread hashing_demo.cpp -o hashing_demo
+// Run:   ./hashing_demo
+//
+// Each section drives one feature against the reference and prints "ok"
+// or the first mismatch; the exit status is the number of failed sections.
+// Worth building with -fsanitize=address,undefined, and the concurrent section
+// with -fsanitize=thread.
+//   incremental   incremental rehash (linear probing, chaining), worst single insert
+//   concurrent    ConcurrentCuckooHashMap seqlocked readers against writers
+//   bulk_build    parallel bulk load, both dedup policies
+//   snapshot      save() / open() round trip
+//   purge         in-place tombstone purge and auto-shrink
+//   moves         moved-from maps stay usable
+//   patterned     keys a weak hash policy piles onto a few home slots
+#include "hashing.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+using Reference = std::unordered_map<int, int>;
+
+static int failures = 0;
+
+// Prints a failed check; returns ok so a section can stop at its first failure.
+static bool expect(bool ok, const char* section, const char* what) {
+    if (!ok) std::printf("%-12s FAILED: %s\n", section, what);
+    return ok;
+}
+
+// Same contents as ref: equal sizes and every reference entry found.
+template <typename Map>
+static bool same(const Map& m, const Reference& ref) {
+    if (m.size() != ref.size()) return false;
+    for (const auto& kv : ref) {
+        auto v = m.find(kv.first);
+        if (!v || *v != kv.second) return false;
+    }
+    return true;
+}
+
+// Random inserts and erases over a small key range, mirrored into ref.
+template <typename Map>
+static bool churn(Map& m, Reference& ref, size_t ops, int range, std::mt19937& rng) {
+    for (size_t i = 0; i < ops; ++i) {
+        int k = static_cast<int>(rng() % range), v = static_cast<int>(rng());
+        if (rng() % 3) {
+            if (m.insert(k, v) != ref.insert_or_assign(k, v).second) return false;
+        } else if (m.erase(k) != (ref.erase(k) == 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Slowest single insert of key_of(0 .. n-1), in microseconds.
+template <typename Map, typename KeyOf>
+static double worst_insert(Map& m, int n, KeyOf key_of) {
+    double worst = 0;
+    for (int i = 0; i < n; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        m.insert(key_of(i), i);
+        std::chrono::duration<double, std::micro> took = std::chrono::steady_clock::now() - t0;
+        worst = std::max(worst, took.count());
+    }
+    return worst;
+}
+
+static void report(const char* section, bool ok) {
+    if (ok) std::printf("%-12s ok\n", section);
+    else ++failures;
+}
+
+// -----------------------------
+// Sections
+// -----------------------------
+static bool incremental() {
+    const char* s = "incremental";
+    std::mt19937 rng(1);
+    LinearProbingHashMap<int, int> lin(8);
+    lin.set_incremental_rehash(4);
+    ChainingHashMap<int, int> chain(4);
+    chain.set_incremental_rehash(2);
+    Reference ref_lin, ref_chain;
+    bool saw_migration = false;
+    for (int round = 0; round < 50; ++round) {
+        if (!expect(churn(lin, ref_lin, 2000, 20000, rng), s, "linear insert/erase result")) return false;
+        if (!expect(churn(chain, ref_chain, 2000, 20000, rng), s, "chaining insert/erase result")) return false;
+        saw_migration |= lin.rehashing();
+        // lookups must see both tables while a migration is pending
+        if (!expect(same(lin, ref_lin), s, "linear contents mid-migration")) return false;
+    }
+    lin.finish_rehash();
+    return expect(saw_migration, s, "no migration observed") && expect(same(lin, ref_lin), s, "linear contents") &&
+           expect(same(chain, ref_chain), s, "chaining contents");
+}
+
+// Worst single insert at the smallest step, against stop-the-world growth,
+// for sequential keys (one long cluster under DivisionHash) and random ones.
+template <typename Map>
+static bool latency_one(const char* what, bool sequential) {
+    const int n = 1 << 21;
+    auto key_of = [sequential](int i) { return sequential ? i : static_cast<int>(i * 2654435761u); };
+    Map stw, inc;
+    inc.set_incremental_rehash(1);
+    double stw_us = worst_insert(stw, n, key_of), inc_us = worst_insert(inc, n, key_of);
+    std::printf("%-12s %s %s keys: worst insert %.0f us, stop-the-world %.0f us\n", "incremental", what,
+                sequential ? "sequential" : "random", inc_us, stw_us);
+    return expect(inc_us * 2 < stw_us, "incremental", "worst insert not bounded");
+}
+
+static bool latency() {
+    return latency_one<LinearProbingHashMap<int, int>>("linear", true) &&
+           latency_one<LinearProbingHashMap<int, int>>("linear", false) &&
+           latency_one<ChainingHashMap<int, int>>("chaining", true) &&
+           latency_one<ChainingHashMap<int, int>>("chaining", false);
+}
+
+static bool concurrent() {
+    const char* s = "concurrent";
+    // Writers own disjoint key ranges and only ever store k * 7, so a reader
+    // seeing any other value caught a torn or stale slot.
+    ConcurrentCuckooHashMap<int, int> m(16);
+    const int kWriters = 2, kRange = 20000;
+    std::atomic<bool> done{false};
+    std::atomic<int> bad{0};
+    std::vector<Reference> finals(kWriters);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < kWriters; ++w)
+        threads.emplace_back([&, w] {
+            std::mt19937 rng(10 + w);
+            for (int i = 0; i < 200000; ++i) {
+                int k = w * kRange + static_cast<int>(rng() % kRange);
+                if (rng() % 4) {
+                    m.insert(k, k * 7);
+                    finals[w][k] = k * 7;
+                } else {
+                    m.erase(k);
+                    finals[w].erase(k);
+                }
+            }
+        });
+    for (int r = 0; r < 2; ++r)
+        threads.emplace_back([&] {
+            std::mt19937 rng(20);
+            while (!done.load(std::memory_order_relaxed)) {
+                int k = static_cast<int>(rng() % (kWriters * kRange));
+                auto v = m.find(k);
+                if (v && *v != k * 7) bad.fetch_add(1);
+            }
+        });
+    for (int w = 0; w < kWriters; ++w) threads[w].join();
+    done = true;
+    for (size_t t = kWriters; t < threads.size(); ++t) threads[t].join();
+    Reference ref;
+    for (const auto& f : finals) ref.insert(f.begin(), f.end());
+    bool ok = expect(bad.load() == 0, s, "reader saw a torn value") && expect(m.size() == ref.size(), s, "size");
+    for (const auto& kv : ref) {
+        if (!ok) break;
+        auto v = m.find(kv.first);
+        ok = expect(v && *v == kv.second, s, "final contents");
+    }
+    return ok;
+}
+
+// Both dedup policies, then a second load on top of the existing contents.
+template <typename Map>
+static bool bulk_one(const char* what, const std::vector<std::pair<int, int>>& items, const Reference& last,
+                     const Reference& first) {
+    const char* s = "bulk_build";
+    Map m_last, m_first;
+    m_last.bulk_build(items, DedupPolicy::LastWins, 4);
+    m_first.bulk_build(items, DedupPolicy::FirstWins, 4);
+    bool ok = expect(same(m_last, last), s, (std::string(what) + ", last wins").c_str()) &&
+              expect(same(m_first, first), s, (std::string(what) + ", first wins").c_str());
+    m_last.bulk_build(items, DedupPolicy::FirstWins, 4);
+    return ok && expect(same(m_last, last), s, (std::string(what) + ", second load").c_str());
+}
+
+static bool bulk_build() {
+    // 200k items over 150k keys: plenty of duplicates, well past the serial cutoff
+    std::mt19937 rng(3);
+    std::vector<std::pair<int, int>> items(200000);
+    for (auto& kv : items) kv = {static_cast<int>(rng() % 150000), static_cast<int>(rng())};
+    Reference last, first;
+    for (const auto& kv : items) {
+        last[kv.first] = kv.second;
+        first.emplace(kv.first, kv.second);
+    }
+    return bulk_one<LinearProbingHashMap<int, int>>("linear", items, last, first) &&
+           bulk_one<ChainingHashMap<int, int>>("chaining", items, last, first) &&
+           bulk_one<RobinHoodHashMap<int, int>>("robin hood", items, last, first) &&
+           bulk_one<ConcurrentHashMap<int, int>>("concurrent", items, last, first);
+}
+
+static bool snapshot() {
+    const char* s = "snapshot";
+    const std::string path = "hashing_demo.snapshot";
+    std::mt19937 rng(4);
+    LinearProbingHashMap<int, int> m;
+    Reference ref;
+    if (!expect(churn(m, ref, 50000, 30000, rng), s, "building the map")) return false;
+    m.save(path);
+    bool ok = true;
+    {
+        auto view = LinearProbingHashMap<int, int>::open(path);
+        ok = expect(view.size() == ref.size(), s, "size");
+        for (int k = 0; ok && k < 40000; ++k) {
+            auto it = ref.find(k);
+            auto v = view.find(k);
+            ok = expect(it == ref.end() ? !v : (v && *v == it->second), s, "lookup");
+        }
+    }
+    std::remove(path.c_str());
+    return ok;
+}
+
+template <typename Map>
+static bool purge_one(Map& m, const char* what) {
+    const char* s = "purge";
+    std::mt19937 rng(2);
+    Reference ref;
+    if (!expect(churn(m, ref, 60000, 4000, rng), s, what)) return false;
+    m.purge_tombstones();
+    if (!expect(m.stats().tombstones == 0, s, what) || !expect(same(m, ref), s, what)) return false;
+    // auto-shrink: erase almost everything, the table must follow
+    size_t before = m.stats().capacity;
+    m.set_shrink_load(0.1);
+    for (int k = 0; k < 4000; ++k)
+        if (k % 50) {
+            m.erase(k);
+            ref.erase(k);
+        }
+    return expect(m.stats().capacity < before, s, what) && expect(same(m, ref), s, what);
+}
+
+static bool purge() {
+    LinearProbingHashMap<int, int> lin;
+    QuadraticProbingHashMap<int, int> quad;
+    DoubleHashingHashMap<int, int> dbl;
+    SwissHashMap<int, int> swiss;
+    return purge_one(lin, "linear") && purge_one(quad, "quadratic") && purge_one(dbl, "double hashing") &&
+           purge_one(swiss, "swiss");
+}
+
+template <typename Map>
+static bool moved_from(const char* what) {
+    const char* s = "moves";
+    Map a;
+    for (int k = 0; k < 1000; ++k) a.insert(k, k);
+    Map b = std::move(a);
+    a.clear();
+    bool ok = expect(b.size() == 1000 && b.find(999) && *b.find(999) == 999, s, what);
+    ok = ok && expect(a.size() == 0 && !a.contains(5), s, what);
+    ok = ok && expect(a.insert(5, 50) && a.find(5) && *a.find(5) == 50, s, what);
+    Map c;
+    c.insert(1, 1);
+    c = std::move(b);
+    ok = ok && expect(c.size() == 1000, s, what);
+    b.clear();
+    return ok && expect(b.insert(2, 2) && b.size() == 1, s, what);
+}
+
+static bool moves() {
+    return moved_from<SmallHashMap<LinearProbingHashMap<int, int>>>("small") &&
+           moved_from<BloomFilteredMap<LinearProbingHashMap<int, int>>>("bloom") &&
+           moved_from<ChainingHashMap<int, int>>("chaining");
+}
+
+// Sequential keys under MidSquareHash: every key below 256 gets the same hash
+// and the rest crowd into few neighborhoods or bucket pairs, so the overflow
+// handling must take over without throwing or losing keys.
+template <typename Map>
+static bool patterned_one(const char* what) {
+    const char* s = "patterned";
+    try {
+        Map m;
+        Reference ref;
+        for (int k = 0; k < 50000; ++k) {
+            m.insert(k, k);
+            ref[k] = k;
+        }
+        std::mt19937 rng(5);
+        return expect(same(m, ref), s, what) && expect(churn(m, ref, 50000, 60000, rng), s, what) &&
+               expect(same(m, ref), s, what);
+    } catch (const std::exception& e) {
+        std::printf("%-12s FAILED: %s threw %s\n", s, what, e.what());
+        return false;
+    }
+}
+
+static bool patterned() {
+    return patterned_one<HopscotchHashMap<int, int, MidSquareHash<int>>>("hopscotch") &&
+           patterned_one<BucketizedCuckooHashMap<int, int, MidSquareHash<int>>>("bucketized cuckoo") &&
+           patterned_one<ConcurrentCuckooHashMap<int, int, MidSquareHash<int>>>("concurrent cuckoo");
+}
+
+int main() {
+    report("incremental", incremental() && latency());
+    report("concurrent", concurrent());
+    report("bulk_build", bulk_build());
+    report("snapshot", snapshot());
+    report("purge", purge());
+    report("moves", moves());
+    report("patterned", patterned());
+    return failures;
+}